@@ -3,6 +3,15 @@ import random
 import re
 import sys
 import time
+
+# the compiled engine, if it is built, gives the same names for integer
+# seeds without reparsing the file on every call
+try:
+   import peres
+except ImportError:
+   peres = None
+
+compiled = dict()
     
 def main():
    names = generate(sys.stdin, None)
@@ -10,6 +19,11 @@ def main():
      print name
 
 def genFromFile(filename, seed):
+   # peres takes seeds that fit a C long long
+   if peres is not None and isinstance(seed, (int, long)) and -2**63 <= seed < 2**63:
+      if filename not in compiled:
+         compiled[filename] = peres.Syllabary(filename)
+      return compiled[filename].generate(seed, 15)
    file = open(filename, 'r')
    return generate(file, seed)
 
@@ -0,0 +1,485 @@
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <map>
+
+#include "analyzer.h"
+
+#define NUM_BUCKETS		0x10000
+
+// state of one word in the DP: DFA state, content class of the previous
+// segment + 1, a nibble per tracked phoneme count and the histogram bucket
+static inline uint64 packState(int state, int last, uint64 counts, int bucket) {
+	return (uint64)state | ((uint64)(last + 1) << 16) | (counts << 24) | ((uint64)bucket << 48);
+}
+
+static inline void unpackState(uint64 key, int &state, int &last, uint64 &counts, int &bucket) {
+	state = (int)(key & 0xFFFF);
+	last = (int)((key >> 16) & 0xFF) - 1;
+	counts = (key >> 24) & 0xFFFFFF;
+	bucket = (int)(key >> 48);
+}
+
+NameAnalyzer::NameAnalyzer(const CountDistribution &syllableCounts) :
+	_rules(en_phonotactics()), _inventory(en_inventory()), _positions(en_positionalTables()), _acceptance(0), _exact(true) {
+
+	for (int i = 0; i < syllableCounts.size(); i++) {
+		int n = syllableCounts.item(i);
+		if (n >= 1 && n <= MAX_SYLLABLES)
+			_syllableCounts.addItem((unsigned char)n, syllableCounts.frequency(i));
+	}
+
+	assert(_rules.numStates() <= 0x10000 && _rules.numSegments() < 0xFF);
+
+	for (int p = 0; p < MAX_COUNTED_PHONEMES; p++) {
+		for (int id = 0; id < _rules.numSegments(); id++) {
+			if (_rules.phonemeCount(id, p)) {
+				_counted.push_back(p);
+				break;
+			}
+		}
+	}
+
+	// the syllable generators redraw until a syllable passes, which scales
+	// every word by the mass of the syllables that pass in each position
+	for (int position = 0; position < kNumPositions; position++) {
+		const SegmentDistribution &onsets = _positions.table(position, kSlotOnset).distribution();
+		const SegmentDistribution &nuclei = _positions.table(position, kSlotNucleus).distribution();
+		const SegmentDistribution &codas = _positions.table(position, kSlotCoda).distribution();
+		bool closed = isClosedPosition(position);
+
+		_mass[position] = 0;
+		for (int o = 0; o < onsets.size(); o++) {
+			for (int n = 0; n < nuclei.size(); n++) {
+				Syllable s;
+				s.onset = onsets.item(o);
+				s.nucleus = nuclei.item(n);
+
+				double weight = (double)onsets.frequency(o) / onsets.cumFreq() * nuclei.frequency(n) / nuclei.cumFreq();
+				if (!closed) {
+					if (_rules.acceptsSyllable(s))
+						_mass[position] += weight;
+					continue;
+				}
+
+				for (int c = 0; c < codas.size(); c++) {
+					s.coda = codas.item(c);
+					if (_rules.acceptsSyllable(s))
+						_mass[position] += weight * codas.frequency(c) / codas.cumFreq();
+				}
+			}
+		}
+	}
+}
+
+void NameAnalyzer::buildSteps(int numSyllables, std::vector<Step> &steps) const {
+	steps.clear();
+
+	for (int syl = 0; syl < numSyllables; syl++) {
+		for (int slot = kSlotOnset; slot < kNumSlots; slot++) {
+			if (slot == kSlotCoda && syl < numSyllables - 1)
+				continue;
+
+			const SegmentDistribution &dist = _positions.table(syllablePosition(syl, numSyllables), slot).distribution();
+
+			// the same segment may be listed twice
+			std::map<int, double> probs;
+			for (int i = 0; i < dist.size(); i++) {
+				const Segment &seg = dist.item(i);
+				probs[seg._numItems > 0 ? seg._id : 0] += (double)dist.frequency(i) / dist.cumFreq();
+			}
+
+			Step step;
+			step.slot = slot;
+			for (std::map<int, double>::const_iterator it = probs.begin(); it != probs.end(); ++it) {
+				Item item;
+				item.id = it->first;
+				item.prob = it->second;
+				item.logProb = log(it->second);
+				item.bucket = (int)floor(-item.logProb * ANALYZER_BUCKETS_PER_NAT + 0.5);
+				step.items.push_back(item);
+			}
+			steps.push_back(step);
+		}
+	}
+}
+
+void NameAnalyzer::walk(const std::vector<Step> &steps, const std::vector<int> &tracked, StateMap &states) const {
+	int numTracked = (int)tracked.size();
+	int numSteps = (int)steps.size();
+	const int *contents = _rules.contentClasses();
+
+	// a tracked phoneme only matters while it can still go over its limit
+	std::vector<int> need(numTracked);
+	std::vector<int> remaining((numSteps + 1) * numTracked, 0);
+	for (int t = 0; t < numTracked; t++) {
+		int phoneme = _counted[tracked[t]];
+		need[t] = _rules.phonemeLimit(phoneme) + 1;
+
+		for (int k = numSteps - 1; k >= 0; k--) {
+			int most = 0;
+			for (size_t i = 0; i < steps[k].items.size(); i++) {
+				int c = _rules.phonemeCount(steps[k].items[i].id, phoneme);
+				most = c > most ? c : most;
+			}
+			remaining[k * numTracked + t] = remaining[(k + 1) * numTracked + t] + most;
+		}
+	}
+
+	// the previous segment only matters while a segment with the same
+	// content can still come right after it, across empty onsets
+	std::vector<char> repeatable((numSteps + 1) * _rules.numSegments(), 0);
+	for (int k = numSteps - 1; k >= 0; k--) {
+		char *row = &repeatable[k * _rules.numSegments()];
+		for (size_t i = 0; i < steps[k].items.size(); i++) {
+			int id = steps[k].items[i].id;
+			if (id)
+				row[contents[id]] = 1;
+			else
+				for (int c = 0; c < _rules.numSegments(); c++)
+					row[c] |= repeatable[(k + 1) * _rules.numSegments() + c];
+		}
+	}
+
+	StateMap next;
+	Moments one;
+	one.count = 1;
+	one.mass = 1;
+	one.massSq = 1;
+
+	states.clear();
+	states[packState(_rules.startState(), -1, 0, 0)] = one;
+
+	for (int k = 0; k < numSteps; k++) {
+		const Step &step = steps[k];
+		next.clear();
+
+		for (StateMap::const_iterator it = states.begin(); it != states.end(); ++it) {
+			int state, last, bucket;
+			uint64 counts;
+			unpackState(it->first, state, last, counts, bucket);
+			const Moments &m = it->second;
+
+			for (size_t i = 0; i < step.items.size(); i++) {
+				const Item &item = step.items[i];
+				int nextState = state, nextLast = last;
+				uint64 nextCounts = counts;
+				bool feasible = true;
+
+				if (item.id) {
+					nextState = _rules.step(state, step.slot, item.id);
+					if (nextState == Phonotactics::kDeadState)
+						continue;
+					if (_rules.noRepeat() && contents[item.id] == last)
+						continue;
+					nextLast = contents[item.id];
+				}
+				if (nextLast >= 0 && !repeatable[(k + 1) * _rules.numSegments() + nextLast])
+					nextLast = -1;
+
+				for (int t = 0; t < numTracked && feasible; t++) {
+					int c = (int)((nextCounts >> (4 * t)) & 15) + _rules.phonemeCount(item.id, _counted[tracked[t]]);
+					c = c < need[t] ? c : need[t];
+					nextCounts = (nextCounts & ~(15ULL << (4 * t))) | ((uint64)c << (4 * t));
+					feasible = c + remaining[(k + 1) * numTracked + t] >= need[t];
+				}
+				if (!feasible)
+					continue;
+
+				int nextBucket = bucket + item.bucket < NUM_BUCKETS ? bucket + item.bucket : NUM_BUCKETS - 1;
+				Moments &d = next[packState(nextState, nextLast, nextCounts, nextBucket)];
+				d.count += m.count;
+				d.mass += m.mass * item.prob;
+				d.massLog += (m.massLog + m.mass * item.logProb) * item.prob;
+				d.massSq += m.massSq * item.prob * item.prob;
+			}
+		}
+
+		states.swap(next);
+	}
+}
+
+// adds sign times the words in which every tracked phoneme goes over its
+// limit, returns how many there are
+double NameAnalyzer::include(const std::vector<Step> &steps, const std::vector<int> &tracked, double sign, Totals &totals) const {
+	StateMap states;
+	walk(steps, tracked, states);
+
+	double count = 0;
+	for (StateMap::const_iterator it = states.begin(); it != states.end(); ++it) {
+		const Moments &m = it->second;
+		int bucket = (int)(it->first >> 48);
+
+		count += m.count;
+		totals.moments.count += sign * m.count;
+		totals.moments.mass += sign * m.mass;
+		totals.moments.massLog += sign * m.massLog;
+		totals.moments.massSq += sign * m.massSq;
+		totals.bucketCount[bucket] += sign * m.count;
+		totals.bucketMass[bucket] += sign * m.mass;
+	}
+
+	return count;
+}
+
+// sets of three and more; a phoneme joins only if it can go over its limit
+// together with each member, as a pair
+void NameAnalyzer::expand(const std::vector<Step> &steps, std::vector<int> &tracked, int from,
+	const std::vector<double> &pairs, double sign, Totals &totals) {
+
+	int numCounted = (int)_counted.size();
+
+	for (int j = from; j < numCounted; j++) {
+		bool possible = true;
+		for (size_t t = 0; t < tracked.size() && possible; t++)
+			possible = pairs[tracked[t] * numCounted + j] > 0;
+		if (!possible)
+			continue;
+
+		if ((int)tracked.size() >= ANALYZER_MAX_TRACKED) {
+			_exact = false;
+			continue;
+		}
+
+		tracked.push_back(j);
+		if (include(steps, tracked, sign, totals) > 0)
+			expand(steps, tracked, j + 1, pairs, -sign, totals);
+		tracked.pop_back();
+	}
+}
+
+// pair of words during the rendered collision DP: both positions, DFA states
+// and previous contents, plus the spelling the leading word is ahead by
+struct PairKey {
+	uint64	words;
+	uint64	pending;		// leader << 63 | length << 56 | characters
+
+	bool operator==(const PairKey &other) const {
+		return words == other.words && pending == other.pending;
+	}
+};
+
+struct PairKeyHash {
+	size_t operator()(const PairKey &key) const {
+		return (size_t)mix64(key.words ^ mix64(key.pending));
+	}
+};
+
+typedef std::unordered_map<PairKey, double, PairKeyHash> PairMap;
+
+double NameAnalyzer::renderedCollisions(int n1, int n2) const {
+	std::vector<Step> steps[2];
+	buildSteps(n1, steps[0]);
+	buildSteps(n2, steps[1]);
+
+	int length[2] = { (int)steps[0].size(), (int)steps[1].size() };
+	const int *contents = _rules.contentClasses();
+
+	// every transition moves one of the words a slot on, so the states of
+	// one level only feed the next
+	std::vector<PairMap> levels(length[0] + length[1] + 1);
+	PairKey start;
+	start.words = 0;
+	for (int w = 0; w < 2; w++)
+		start.words |= (uint64)_rules.startState() << (10 + 16 * w) | (uint64)0 << (42 + 8 * w);
+	start.pending = 0;
+	levels[0][start] = 1;
+
+	for (int level = 0; level < length[0] + length[1]; level++) {
+		for (PairMap::const_iterator it = levels[level].begin(); it != levels[level].end(); ++it) {
+			uint64 words = it->first.words;
+			int pos[2], state[2], last[2];
+			for (int w = 0; w < 2; w++) {
+				pos[w] = (int)((words >> (5 * w)) & 31);
+				state[w] = (int)((words >> (10 + 16 * w)) & 0xFFFF);
+				last[w] = (int)((words >> (42 + 8 * w)) & 0xFF) - 1;
+			}
+
+			int leader = (int)(it->first.pending >> 63);
+			int pendingLength = (int)((it->first.pending >> 56) & 0x7F);
+			char pending[8];
+			for (int c = 0; c < pendingLength; c++)
+				pending[c] = (char)((it->first.pending >> (8 * c)) & 0xFF);
+
+			// the word behind moves; with nothing pending, the first one
+			// that still has slots left
+			int w = pendingLength ? 1 - leader : (pos[0] < length[0] ? 0 : 1);
+			if (pos[w] == length[w])
+				continue;
+
+			const Step &step = steps[w][pos[w]];
+			for (size_t i = 0; i < step.items.size(); i++) {
+				const Item &item = step.items[i];
+				int nextState = state[w], nextLast = last[w];
+
+				if (item.id) {
+					nextState = _rules.step(state[w], step.slot, item.id);
+					if (nextState == Phonotactics::kDeadState)
+						continue;
+					if (_rules.noRepeat() && contents[item.id] == last[w])
+						continue;
+					nextLast = contents[item.id];
+				}
+
+				const char *spelling = item.id ? _inventory[item.id]._spelling : "";
+				int spellingLength = (int)strlen(spelling);
+				char nextPending[8];
+				int nextLength, nextLeader;
+
+				if (!pendingLength) {
+					assert(spellingLength < 8);
+					memcpy(nextPending, spelling, spellingLength);
+					nextLength = spellingLength;
+					nextLeader = w;
+				} else if (spellingLength <= pendingLength) {
+					if (memcmp(spelling, pending, spellingLength))
+						continue;
+					nextLength = pendingLength - spellingLength;
+					memcpy(nextPending, pending + spellingLength, nextLength);
+					nextLeader = leader;
+				} else {
+					if (memcmp(spelling, pending, pendingLength))
+						continue;
+					nextLength = spellingLength - pendingLength;
+					memcpy(nextPending, spelling + pendingLength, nextLength);
+					nextLeader = w;
+				}
+
+				PairKey key;
+				key.words = words;
+				key.words &= ~((31ULL << (5 * w)) | (0xFFFFULL << (10 + 16 * w)) | (0xFFULL << (42 + 8 * w)));
+				key.words |= (uint64)(pos[w] + 1) << (5 * w);
+				key.words |= (uint64)nextState << (10 + 16 * w);
+				key.words |= (uint64)(nextLast + 1) << (42 + 8 * w);
+
+				key.pending = nextLength ? (uint64)nextLeader << 63 | (uint64)nextLength << 56 : 0;
+				for (int c = 0; c < nextLength; c++)
+					key.pending |= (uint64)(unsigned char)nextPending[c] << (8 * c);
+
+				levels[level + 1][key] += it->second * item.prob;
+			}
+		}
+
+		PairMap().swap(levels[level]);
+	}
+
+	double total = 0;
+	for (PairMap::const_iterator it = levels.back().begin(); it != levels.back().end(); ++it) {
+		if (!it->first.pending)
+			total += it->second;
+	}
+	return total;
+}
+
+void NameAnalyzer::analyze(NameStats &stats) {
+	int numCounted = (int)_counted.size();
+	std::vector<Moments> regular(MAX_SYLLABLES + 1);
+
+	_totals.assign(MAX_SYLLABLES + 1, Totals());
+	_scale.assign(MAX_SYLLABLES + 1, 0);
+	_exact = true;
+
+	for (int i = 0; i < _syllableCounts.size(); i++) {
+		int n = _syllableCounts.item(i);
+		Totals &totals = _totals[n];
+		std::vector<Step> steps;
+		std::vector<int> tracked;
+
+		buildSteps(n, steps);
+		totals.bucketCount.assign(NUM_BUCKETS, 0);
+		totals.bucketMass.assign(NUM_BUCKETS, 0);
+		_scale[n] = (double)_syllableCounts.frequency(i) / _syllableCounts.cumFreq();
+		for (int syl = 0; syl < n; syl++)
+			_scale[n] /= _mass[syllablePosition(syl, n)];
+
+		include(steps, tracked, 1, totals);
+		regular[n] = totals.moments;
+
+		std::vector<double> singles(numCounted, 0);
+		for (int a = 0; a < numCounted; a++) {
+			tracked.assign(1, a);
+			singles[a] = include(steps, tracked, -1, totals);
+		}
+
+		std::vector<double> pairs(numCounted * numCounted, 0);
+		for (int a = 0; a < numCounted; a++) {
+			for (int b = a + 1; b < numCounted && singles[a] > 0; b++) {
+				if (singles[b] <= 0)
+					continue;
+				tracked.assign(1, a);
+				tracked.push_back(b);
+				pairs[a * numCounted + b] = pairs[b * numCounted + a] = include(steps, tracked, 1, totals);
+			}
+		}
+
+		for (int a = 0; a < numCounted; a++) {
+			for (int b = a + 1; b < numCounted; b++) {
+				if (pairs[a * numCounted + b] <= 0)
+					continue;
+				tracked.assign(1, a);
+				tracked.push_back(b);
+				expand(steps, tracked, b + 1, pairs, -1, totals);
+			}
+		}
+	}
+
+	// p(word) = scale[n] * q(word) / acceptance
+	double acceptance = 0, words = 0;
+	for (int n = 1; n <= MAX_SYLLABLES; n++) {
+		acceptance += _scale[n] * _totals[n].moments.mass;
+		words += _totals[n].moments.count;
+	}
+	_acceptance = acceptance;
+
+	double entropy = 0, collision = 0, regularCollision = 0, renderedCollision = 0;
+	for (int n = 1; n <= MAX_SYLLABLES; n++) {
+		if (!_scale[n])
+			continue;
+		const Moments &m = _totals[n].moments;
+		double c = _scale[n] / acceptance;
+
+		entropy -= c * (m.massLog + m.mass * log(c));
+		collision += c * c * m.massSq;
+		regularCollision += c * c * regular[n].massSq;
+
+		for (int n2 = 1; n2 <= MAX_SYLLABLES; n2++) {
+			if (_scale[n2])
+				renderedCollision += c * _scale[n2] / acceptance * renderedCollisions(n, n2);
+		}
+	}
+
+	stats.validWords = words;
+	stats.acceptance = acceptance;
+	stats.entropy = entropy / log(2.0);
+	stats.collision = collision;
+	stats.collapse = regularCollision > 0 ? renderedCollision / regularCollision : 1;
+	stats.renderedCollision = collision * stats.collapse;
+	stats.exact = _exact;
+}
+
+double NameAnalyzer::expectedDistinct(double draws, double collapse) const {
+	double expected = 0;
+
+	for (int n = 1; n <= MAX_SYLLABLES && n < (int)_totals.size(); n++) {
+		const Totals &totals = _totals[n];
+		if (!_scale[n])
+			continue;
+
+		for (size_t b = 0; b < totals.bucketCount.size(); b++) {
+			// the signed sums leave rounding noise in emptied buckets
+			if (totals.bucketCount[b] < 0.5 || totals.bucketMass[b] <= 0)
+				continue;
+			// collapse words of the bucket's probability share each name
+			double p = collapse * _scale[n] / _acceptance * totals.bucketMass[b] / totals.bucketCount[b];
+			p = p < 1 ? p : 1;
+			expected += totals.bucketCount[b] / collapse * -expm1(draws * log1p(-p));
+		}
+	}
+
+	return expected;
+}
+
+double NameAnalyzer::drawsForCollision(double collision, double probability) {
+	return sqrt(2 * log(1 / (1 - probability)) / collision);
+}
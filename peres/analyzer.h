@@ -0,0 +1,118 @@
+#ifndef __ANALYZER__
+#define __ANALYZER__
+
+#include <unordered_map>
+#include <vector>
+
+#include "misc.h"
+#include "generator.h"
+
+// resolution of the log probability histogram behind expectedDistinct()
+#define ANALYZER_BUCKETS_PER_NAT	64
+
+// maxcount sets deeper than this are not expanded, see NameStats::exact
+#define ANALYZER_MAX_TRACKED		6
+
+struct NameStats {
+	double	validWords;			// distinct words generateValid() can return
+	double	acceptance;			// chance a drawn candidate passes validation
+	double	entropy;			// of the accepted words, in bits
+	double	collision;			// chance two accepted words are the same
+	double	renderedCollision;	// chance two accepted words render the same
+	double	collapse;			// renderedCollision / collision
+	bool	exact;				// false if the maxcount expansion was cut off
+};
+
+// Computes statistics of the names EnglishWordGenerator::generateValid()
+// returns, without drawing any.
+//
+// A word of n syllables is a fixed sequence of slot draws, so a DP over the
+// slots whose state is the phonotactic DFA state plus the content of the
+// previous segment sums any product weight over exactly the words passing
+// the forbid, limit and norepeat rules. Each state carries the number of
+// words, their probability mass, sum of p log p and sum of p^2, which is
+// all entropy and collision probability need.
+//
+// maxcount rules depend on the whole multiset of phonemes and would make
+// the state explode; they are handled by inclusion-exclusion instead. For
+// a set T of limited phonemes a DP tracking only their counts gives the
+// words in which all of T go over their limits, and the valid words are the
+// alternating sum over all T. Sets are grown depth first and dropped as
+// soon as no word can exceed all of them, which in practice leaves a few
+// hundred small DPs.
+//
+// The chance that two names render to the same string is a DP over pairs
+// of words kept in step on their spelling. It applies the DFA and the
+// repeat check to both words but not maxcount, which would need the
+// inclusion-exclusion over pairs of sets.
+class NameAnalyzer {
+
+	struct Item {
+		int		id;				// 0 for an empty onset or coda
+		double	prob;
+		double	logProb;
+		int		bucket;			// -logProb in histogram buckets
+	};
+
+	struct Step {
+		int					slot;
+		std::vector<Item>	items;
+	};
+
+	struct Moments {
+		double	count;
+		double	mass;
+		double	massLog;
+		double	massSq;
+
+		Moments() : count(0), mass(0), massLog(0), massSq(0) {
+		}
+	};
+
+	typedef std::unordered_map<uint64, Moments> StateMap;
+
+	// signed sums over all inclusion-exclusion terms of one syllable count
+	struct Totals {
+		Moments				moments;
+		std::vector<double>	bucketCount;
+		std::vector<double>	bucketMass;
+	};
+
+	const Phonotactics		&_rules;
+	const SegmentInventory	&_inventory;
+	const PositionalTables	&_positions;
+	CountDistribution		_syllableCounts;
+
+	std::vector<int>		_counted;		// phonemes limited by maxcount
+	double					_mass[kNumPositions];	// of the syllables passing the rules
+
+	std::vector<Totals>		_totals;		// [syllables]
+	std::vector<double>		_scale;			// [syllables] candidate probability / q
+	double					_acceptance;
+	bool					_exact;
+
+	void buildSteps(int numSyllables, std::vector<Step> &steps) const;
+	void walk(const std::vector<Step> &steps, const std::vector<int> &tracked, StateMap &states) const;
+	double include(const std::vector<Step> &steps, const std::vector<int> &tracked, double sign, Totals &totals) const;
+	void expand(const std::vector<Step> &steps, std::vector<int> &tracked, int from,
+		const std::vector<double> &pairs, double sign, Totals &totals);
+	double renderedCollisions(int n1, int n2) const;
+
+public:
+	NameAnalyzer(const CountDistribution &syllableCounts);
+
+	void analyze(NameStats &stats);
+
+	// expected number of different words among draws accepted names, from a
+	// histogram of log probabilities; valid after analyze(). With collapse
+	// from NameStats it estimates different rendered names instead, taking
+	// each name to merge that many words of equal probability; against
+	// sampled output the estimate comes out a few percent low
+	double expectedDistinct(double draws, double collapse = 1) const;
+
+	// draws after which a repeat has the given chance, birthday bound; pass
+	// renderedCollision for names, collision for words
+	static double drawsForCollision(double collision, double probability);
+};
+
+#endif
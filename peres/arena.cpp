@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "arena.h"
+
+NameArena::NameArena(bool hugePages, size_t blockSize) :
+	_next(0), _end(0), _size(0), _numNames(0), _allocated(0), _blockSize(blockSize), _hugePages(hugePages) {
+}
+
+NameArena::~NameArena() {
+	release();
+}
+
+void NameArena::release() {
+	for (size_t i = 0; i < _blocks.size(); i++) {
+#ifndef _WIN32
+		if (_blocks[i].mapped) {
+			munmap(_blocks[i].data, _blocks[i].capacity);
+			continue;
+		}
+#endif
+		free(_blocks[i].data);
+	}
+
+	_blocks.clear();
+	_used.clear();
+	_next = _end = 0;
+	_size = 0;
+	_numNames = 0;
+	_allocated = 0;
+}
+
+#ifndef _WIN32
+// an anonymous mapping starting on a huge page boundary, explicit huge pages
+// if there are enough reserved
+static char *mapHugePages(size_t size) {
+#ifdef MAP_HUGETLB
+	void *p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p != MAP_FAILED)
+		return (char *)p;
+#endif
+
+	// over-map by a huge page and trim both ends to the boundary
+	size_t mapped = size + ARENA_BLOCK_SIZE;
+	char *base = (char *)mmap(0, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == (char *)MAP_FAILED)
+		return 0;
+
+	char *aligned = (char *)(((uintptr_t)base + ARENA_BLOCK_SIZE - 1) & ~(uintptr_t)(ARENA_BLOCK_SIZE - 1));
+	if (aligned > base)
+		munmap(base, aligned - base);
+	if (base + mapped > aligned + size)
+		munmap(aligned + size, base + mapped - (aligned + size));
+
+#ifdef MADV_HUGEPAGE
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+	return aligned;
+}
+#endif
+
+void NameArena::grow(size_t capacity) {
+	Block block;
+	block.capacity = capacity > _blockSize ? capacity : _blockSize;
+	block.start = _size;
+	block.mapped = false;
+	block.data = 0;
+
+#ifndef _WIN32
+	if (_hugePages) {
+		block.capacity = (block.capacity + ARENA_BLOCK_SIZE - 1) & ~(size_t)(ARENA_BLOCK_SIZE - 1);
+		block.data = mapHugePages(block.capacity);
+		block.mapped = block.data != 0;
+	}
+#endif
+	if (!block.data)
+		block.data = (char *)malloc(block.capacity);
+	assert(block.data);
+
+	_blocks.push_back(block);
+	_used.push_back(0);
+	_allocated += block.capacity;
+	_next = block.data;
+	_end = block.data + block.capacity;
+}
+
+const char *NameArena::at(uint64 offset) const {
+	// the last block starting at or before offset; an empty block is always
+	// followed by one with the same start
+	int lo = 0, hi = (int)_blocks.size();
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (offset < _blocks[mid].start)
+			hi = mid;
+		else
+			lo = mid;
+	}
+	return _blocks[lo].data + (offset - _blocks[lo].start);
+}
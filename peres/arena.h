@@ -0,0 +1,125 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <string.h>
+
+#include <vector>
+
+#include "misc.h"
+
+// blocks are huge page sized, a name never straddles two
+#define ARENA_BLOCK_SIZE	(1 << 21)
+
+// a stored name; C++11 has no string_view
+struct NameRef {
+	const char	*text;				// 0 terminated, 0 if there is no name
+	int			length;
+};
+
+// Bump pointer pool for names. Names are appended 0 terminated to large
+// blocks which never move, so a NameRef stays valid until release() frees
+// everything at once; there is no per-name allocation or header.
+//
+// Names are numbered by a logical offset, their position in the
+// concatenation of all names, which offset() hands out and at() resolves
+// with a binary search over the blocks. Writing the blocks in order
+// therefore gives the same text as one growing buffer would, without its
+// copies and unused capacity.
+//
+// With hugePages the blocks are mapped as explicit huge pages where the
+// system has them reserved, else advised to become transparent ones.
+//
+// Not thread safe; give each thread its own.
+class NameArena {
+
+	struct Block {
+		char	*data;
+		size_t	capacity;
+		uint64	start;				// logical offset of data[0]
+		bool	mapped;
+	};
+
+	std::vector<Block>	_blocks;
+	std::vector<size_t>	_used;			// [block]
+	char				*_next;
+	char				*_end;
+	uint64				_size;
+	uint64				_numNames;
+	uint64				_allocated;
+	size_t				_blockSize;
+	bool				_hugePages;
+
+	void grow(size_t capacity);
+
+	NameArena(const NameArena &);
+	NameArena &operator=(const NameArena &);
+
+public:
+	NameArena(bool hugePages = false, size_t blockSize = ARENA_BLOCK_SIZE);
+	~NameArena();
+
+	// frees all blocks
+	void release();
+
+	// room for a name of up to capacity - 1 chars and its 0, to be rendered
+	// in place and then commit()ted; a later reserve() without a commit()
+	// reuses it
+	char *reserve(size_t capacity) {
+		if ((size_t)(_end - _next) < capacity)
+			grow(capacity);
+		return _next;
+	}
+
+	// keeps the first length chars of the reserved room as a name
+	NameRef commit(int length) {
+		NameRef ref = { _next, length };
+		_next[length] = '\0';
+		_next += length + 1;
+		_used.back() = _next - _blocks.back().data;
+		_size += length + 1;
+		_numNames++;
+		return ref;
+	}
+
+	NameRef add(const char *text, int length) {
+		char *p = reserve(length + 1);
+		memcpy(p, text, length);
+		return commit(length);
+	}
+
+	NameRef add(const char *text) {
+		return add(text, (int)strlen(text));
+	}
+
+	// logical offset the next name gets
+	uint64 offset() const {
+		return _size;
+	}
+
+	// the name at a logical offset
+	const char *at(uint64 offset) const;
+
+	uint64 numNames() const {
+		return _numNames;
+	}
+
+	// bytes taken from the system
+	uint64 allocated() const {
+		return _allocated;
+	}
+
+	int numBlocks() const {
+		return (int)_blocks.size();
+	}
+
+	const char *blockData(int block) const {
+		return _blocks[block].data;
+	}
+
+	// bytes of names in a block
+	size_t blockSize(int block) const {
+		return _used[block];
+	}
+};
+
+#endif
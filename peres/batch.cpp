@@ -0,0 +1,221 @@
+#include <string.h>
+
+#include "batch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+bool WordBatch::add(const Word &word) {
+	if (numWords >= BATCH_LANES)
+		return false;
+
+	int lane = numWords++;
+	int n = word.numSegments();
+
+	length[lane] = n;
+	for (int p = 0; p < n; p++)
+		spellings[p][lane] = word.segment(p)._spelling;
+	for (int p = 0; p < MAX_SEGS; p++) {
+		ids[p][lane] = (p < n) ? word.segment(p)._id : 0;
+		slots[p][lane] = (p < n) ? word.slot(p) : kSlotOnset;
+	}
+
+	return true;
+}
+
+static uint64 validateScalar(const Phonotactics &rules, const WordBatch &batch) {
+	uint64 survivors = 0;
+
+	for (int lane = 0; lane < batch.numWords; lane++) {
+		int ids[MAX_SEGS];
+		unsigned char slots[MAX_SEGS];
+
+		for (int p = 0; p < batch.length[lane]; p++) {
+			ids[p] = batch.ids[p][lane];
+			slots[p] = (unsigned char)batch.slots[p][lane];
+		}
+
+		survivors |= (uint64)rules.accepts(ids, slots, batch.length[lane]) << lane;
+	}
+
+	return survivors;
+}
+
+#ifdef BATCH_HAVE_AVX2
+
+// one 64 bit counter word for four lanes: add the increments of the active
+// lanes, record top bits, clear them (see Phonotactics::accepts)
+__attribute__((target("avx2")))
+static inline void countPhonemes(__m256i &counter, __m256i &overflow, const uint64 *increments, __m128i index, __m256i active) {
+	const __m256i top = _mm256_set1_epi64x((long long)0x8888888888888888ULL);
+
+	__m256i inc = _mm256_i32gather_epi64((const long long *)increments, index, 8);
+	counter = _mm256_add_epi64(counter, _mm256_and_si256(inc, active));
+	overflow = _mm256_or_si256(overflow, _mm256_and_si256(counter, top));
+	counter = _mm256_andnot_si256(top, counter);
+}
+
+__attribute__((target("avx2")))
+static uint64 validateAvx2(const Phonotactics &rules, const WordBatch &batch) {
+	const int *classTable = (const int *)rules.classTable();
+	const int *table = (const int *)rules.table();
+	const int *contents = rules.contentClasses();
+	const uint64 *increments = rules.countIncrements();
+	const uint64 *bias = rules.countBias();
+
+	const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+	const __m256i numSegments = _mm256_set1_epi32(rules.numSegments());
+	const __m256i numClasses = _mm256_set1_epi32(rules.numClasses());
+	const __m256i three = _mm256_set1_epi32(3);
+	const __m256i zero = _mm256_setzero_si256();
+
+	uint64 survivors = 0;
+	int maxLength = 0;
+	for (int lane = 0; lane < batch.numWords; lane++)
+		maxLength = batch.length[lane] > maxLength ? batch.length[lane] : maxLength;
+
+	for (int group = 0; group < batch.numWords; group += 8) {
+		// lanes past numWords may never have been filled: give them length 0
+		// so that their ids are masked to 0 before any gather
+		__m256i used = _mm256_cmpgt_epi32(_mm256_set1_epi32(batch.numWords - group), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i length = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&batch.length[group]), used);
+		__m256i state = _mm256_set1_epi32(rules.startState());
+		__m256i prev = _mm256_set1_epi32(-1);
+		__m256i repeats = zero;
+		__m256i counter[2][3], overflow[2];
+
+		for (int h = 0; h < 2; h++) {
+			for (int k = 0; k < 3; k++)
+				counter[h][k] = _mm256_set1_epi64x((long long)bias[k]);
+			overflow[h] = zero;
+		}
+
+		for (int p = 0; p < maxLength; p++) {
+			__m256i active = _mm256_cmpgt_epi32(length, _mm256_set1_epi32(p));
+			__m256i id = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&batch.ids[p][group]), active);
+			__m256i slot = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&batch.slots[p][group]), active);
+
+			// the tables hold 16 bit entries: gather 32 bits at a 2 byte scale
+			// and keep the low half
+			__m256i symbol = _mm256_add_epi32(_mm256_mullo_epi32(slot, numSegments), id);
+			__m256i cls = _mm256_and_si256(_mm256_i32gather_epi32(classTable, symbol, 2), low16);
+			__m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(state, numClasses), cls);
+			__m256i next = _mm256_and_si256(_mm256_i32gather_epi32(table, cell, 2), low16);
+			state = _mm256_blendv_epi8(state, next, active);
+
+			__m256i content = _mm256_i32gather_epi32(contents, id, 4);
+			repeats = _mm256_or_si256(repeats, _mm256_and_si256(_mm256_cmpeq_epi32(content, prev), active));
+			prev = _mm256_blendv_epi8(prev, content, active);
+
+			__m256i index = _mm256_mullo_epi32(id, three);
+			for (int h = 0; h < 2; h++) {
+				__m128i half = h ? _mm256_extracti128_si256(index, 1) : _mm256_castsi256_si128(index);
+				__m128i activeHalf = h ? _mm256_extracti128_si256(active, 1) : _mm256_castsi256_si128(active);
+				__m256i active64 = _mm256_cvtepi32_epi64(activeHalf);
+
+				for (int k = 0; k < 3; k++)
+					countPhonemes(counter[h][k], overflow[h], increments + k, half, active64);
+			}
+		}
+
+		// fold the 64 bit overflow words back to one 32 bit flag per lane
+		__m256i ovLanes[2];
+		for (int h = 0; h < 2; h++) {
+			__m256i bad64 = _mm256_cmpeq_epi64(overflow[h], zero);
+			ovLanes[h] = _mm256_permutevar8x32_epi32(bad64, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+		}
+		__m256i clean = _mm256_permute2x128_si256(ovLanes[0], ovLanes[1], 0x20);
+
+		__m256i alive = _mm256_andnot_si256(_mm256_cmpeq_epi32(state, zero), clean);
+		if (rules.noRepeat())
+			alive = _mm256_andnot_si256(repeats, alive);
+
+		uint64 bits = (uint64)_mm256_movemask_ps(_mm256_castsi256_ps(alive));
+		survivors |= bits << group;
+	}
+
+	uint64 used = batch.numWords >= 64 ? ~0ULL : ((1ULL << batch.numWords) - 1);
+	return survivors & used;
+}
+
+#endif
+
+uint64 validateBatch(const Phonotactics &rules, const WordBatch &batch) {
+#ifdef BATCH_HAVE_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	if (avx2)
+		return validateAvx2(rules, batch);
+#endif
+	return validateScalar(rules, batch);
+}
+
+int compactLanes(uint64 mask, unsigned char *lanes) {
+	int n = 0;
+	for (int i = 0; i < BATCH_LANES; i++) {
+		lanes[n] = (unsigned char)i;
+		n += (int)((mask >> i) & 1);
+	}
+	return n;
+}
+
+BatchGenerator::BatchGenerator(EnglishWordGenerator &gen) :
+	_gen(gen), _generated(0), _rejected(0) {
+}
+
+int BatchGenerator::generateBlock(char *names) {
+	Syllable syl[MAX_SYLLABLES];
+
+	_batch.clear();
+	while (_batch.numWords < BATCH_LANES) {
+		Word word(syl, _gen.drawSyllables(syl));
+		_batch.add(word);
+	}
+
+	uint64 survivors = validateBatch(_gen.tables().rules(), _batch);
+
+	unsigned char lanes[BATCH_LANES + 1];
+	int n = compactLanes(survivors, lanes);
+
+	const Blocklist *blocklist = _gen.blocklist();
+	const Orthography *orthography = _gen.orthography();
+	int accepted = 0;
+
+	for (int i = 0; i < n; i++) {
+		int lane = lanes[i];
+		char *dst = names + (size_t)accepted * MAX_NAME_LEN;
+
+		if (orthography) {
+			int ids[MAX_SEGS];
+			unsigned char slots[MAX_SEGS];
+			int length = _batch.length[lane];
+
+			for (int p = 0; p < length; p++) {
+				ids[p] = _batch.ids[p][lane];
+				slots[p] = (unsigned char)_batch.slots[p][lane];
+			}
+			orthography->render(ids, slots, length, dst);
+			accepted += (int)(!blocklist || !blocklist->contains(dst));
+			continue;
+		}
+
+		uint32 state = blocklist ? blocklist->start() : 0;
+		bool clean = true;
+
+		for (int p = 0; p < _batch.length[lane] && clean; p++) {
+			const char *spelling = _batch.spellings[p][lane];
+			clean = !blocklist || blocklist->feed(state, spelling);
+			while (*spelling)
+				*dst++ = *spelling++;
+		}
+		*dst = '\0';
+
+		// a blocked name is overwritten by the next survivor
+		accepted += (int)clean;
+	}
+
+	_generated += BATCH_LANES;
+	_rejected += BATCH_LANES - accepted;
+	return accepted;
+}
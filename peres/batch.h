@@ -0,0 +1,67 @@
+#ifndef __BATCH__
+#define __BATCH__
+
+#include <vector>
+
+#include "misc.h"
+#include "generator.h"
+
+#define BATCH_LANES		64
+
+// A block of candidate words stored structure-of-arrays: position p of
+// every lane is contiguous, so the validator can walk all lanes at once.
+// Positions past a lane's length hold segment 0 in the onset slot. Names
+// are spelled as the segments were drawn, as mixed tables spell an id their
+// own way.
+struct WordBatch {
+	int			numWords;
+	int			length[BATCH_LANES];
+	int			ids[MAX_SEGS][BATCH_LANES];
+	int			slots[MAX_SEGS][BATCH_LANES];
+	const char	*spellings[MAX_SEGS][BATCH_LANES];	// as drawn, up to the lane's length
+
+	void clear() {
+		numWords = 0;
+	}
+
+	// false once all lanes are taken
+	bool add(const Word &word);
+};
+
+// Validates every lane of the batch against the rules, branch free, eight
+// lanes per AVX2 instruction where the CPU has it. Bit i of the result is
+// set if lane i passed.
+uint64 validateBatch(const Phonotactics &rules, const WordBatch &batch);
+
+// writes the indices of the set bits of mask to lanes[], in order, without
+// a data dependent branch; returns how many there were
+int compactLanes(uint64 mask, unsigned char *lanes);
+
+// Offline pipeline: draws BATCH_LANES candidates at a time, validates the
+// whole block against the rules of the generator's current tables and
+// renders only the survivors.
+class BatchGenerator {
+
+	EnglishWordGenerator	&_gen;
+	WordBatch				_batch;
+
+	uint64					_generated;
+	uint64					_rejected;
+
+public:
+	BatchGenerator(EnglishWordGenerator &gen);
+
+	// renders up to BATCH_LANES names into names[i * MAX_NAME_LEN], returns
+	// how many survived validation and the generator's blocklist
+	int generateBlock(char *names);
+
+	uint64 generated() const {
+		return _generated;
+	}
+
+	uint64 rejected() const {
+		return _rejected;
+	}
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "blocklist.h"
+
+Blocklist::Blocklist() : _numClasses(1), _numEntries(0) {
+	memset(_classOf, 0, sizeof(_classOf));
+	_delta.assign(1, 0);
+}
+
+bool Blocklist::compile(const std::vector<std::string> &entries) {
+	// built aside, a failure leaves the previous automaton in use
+	unsigned char classOf[256];
+	int numClasses = 1;
+	int numEntries = 0;
+	memset(classOf, 0, sizeof(classOf));
+
+	for (size_t e = 0; e < entries.size(); e++) {
+		for (size_t i = 0; i < entries[e].size(); i++) {
+			unsigned char c = (unsigned char)tolower((unsigned char)entries[e][i]);
+			if (!classOf[c]) {
+				classOf[c] = (unsigned char)numClasses;
+				classOf[toupper(c)] = (unsigned char)numClasses;
+				numClasses++;
+			}
+		}
+	}
+
+	// trie with dense rows, -1 for no child
+	std::vector<int> next(numClasses, -1);
+	std::vector<char> output(1, 0);
+
+	for (size_t e = 0; e < entries.size(); e++) {
+		const std::string &entry = entries[e];
+		if (entry.empty())
+			continue;
+
+		int node = 0;
+		for (size_t i = 0; i < entry.size(); i++) {
+			int c = classOf[(unsigned char)entry[i]];
+			if (next[node * numClasses + c] < 0) {
+				next[node * numClasses + c] = (int)output.size();
+				output.push_back(0);
+				next.resize(next.size() + numClasses, -1);
+			}
+			node = next[node * numClasses + c];
+		}
+		output[node] = 1;
+		numEntries++;
+	}
+
+	int numNodes = (int)output.size();
+	if ((uint64)numNodes * numClasses * 2 > 0xFFFFFFFFULL) {
+		_error = "blocklist too large";
+		return false;
+	}
+
+	// breadth first, so the failure target of a node is complete before it;
+	// missing children become the transition of the failure node
+	std::vector<int> fail(numNodes, 0);
+	std::vector<int> queue;
+	queue.reserve(numNodes);
+
+	for (int c = 0; c < numClasses; c++) {
+		int &child = next[c];
+		if (child < 0) {
+			child = 0;
+		} else {
+			queue.push_back(child);
+		}
+	}
+
+	for (size_t q = 0; q < queue.size(); q++) {
+		int node = queue[q];
+		output[node] |= output[fail[node]];
+
+		for (int c = 0; c < numClasses; c++) {
+			int &child = next[node * numClasses + c];
+			int target = next[fail[node] * numClasses + c];
+			if (child < 0) {
+				child = target;
+			} else {
+				fail[child] = target;
+				queue.push_back(child);
+			}
+		}
+	}
+
+	std::vector<uint32> delta(next.size());
+	for (size_t i = 0; i < next.size(); i++)
+		delta[i] = ((uint32)(next[i] * numClasses) << 1) | (uint32)output[next[i]];
+
+	_delta.swap(delta);
+	memcpy(_classOf, classOf, sizeof(_classOf));
+	_numClasses = numClasses;
+	_numEntries = numEntries;
+	_error.clear();
+	return true;
+}
+
+bool Blocklist::load(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		_error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	std::vector<std::string> entries;
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		char *hash = strchr(line, '#');
+		if (hash)
+			*hash = '\0';
+
+		char *begin = line;
+		while (isspace((unsigned char)*begin))
+			begin++;
+		char *end = begin + strlen(begin);
+		while (end > begin && isspace((unsigned char)end[-1]))
+			end--;
+
+		if (end > begin)
+			entries.push_back(std::string(begin, end));
+	}
+	fclose(f);
+
+	return compile(entries);
+}
@@ -0,0 +1,70 @@
+#ifndef __BLOCKLIST__
+#define __BLOCKLIST__
+
+#include <string>
+#include <vector>
+
+#include "misc.h"
+
+// Substring blocklist compiled into an Aho-Corasick automaton.
+//
+// The trie of all entries and its failure links are flattened into one dense
+// table over the letters that occur in the list (everything else shares a
+// single class), so scanning costs one table load per character whatever
+// the number of entries. Matching ignores ASCII case. The scan state can be
+// carried across calls, which lets a word be checked segment by segment as
+// its spellings are appended and abandoned at the first hit.
+class Blocklist {
+
+	// entries are (state * _numClasses) << 1, the low bit set if reaching
+	// the state completes an entry
+	std::vector<uint32>		_delta;
+	unsigned char			_classOf[256];
+	int						_numClasses;
+	int						_numEntries;
+
+	std::string				_error;
+
+public:
+	Blocklist();
+
+	// false if the automaton would not fit its 32 bit table, see error();
+	// the previous entries stay in effect then
+	bool compile(const std::vector<std::string> &entries);
+
+	// one entry per line, '#' starts a comment, surrounding blanks ignored
+	bool load(const char *path);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	int numEntries() const {
+		return _numEntries;
+	}
+
+	uint32 start() const {
+		return 0;
+	}
+
+	// advances state over text, false as soon as an entry has been seen
+	bool feed(uint32 &state, const char *text) const {
+		uint32 s = state;
+		for (; *text; text++) {
+			s = _delta[(s >> 1) + _classOf[(unsigned char)*text]];
+			if (s & 1) {
+				state = s;
+				return false;
+			}
+		}
+		state = s;
+		return true;
+	}
+
+	bool contains(const char *text) const {
+		uint32 state = start();
+		return !feed(state, text);
+	}
+};
+
+#endif
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "catalog.h"
+
+static uint64 align(uint64 offset) {
+	return (offset + CATALOG_ALIGNMENT - 1) & ~(uint64)(CATALOG_ALIGNMENT - 1);
+}
+
+void CatalogWriter::addName(const char *name) {
+	_text.add(name);
+	_offsets.push_back((uint32)_text.offset());
+}
+
+void CatalogWriter::add(const char *name, const Word &word, const Orthography *orthography, double probability) {
+	addName(name);
+
+	if (_columns & kColumnSegments) {
+		unsigned char ids[CATALOG_SEGMENTS] = { 0 };
+		for (int i = 0; i < word.numSegments() && i < CATALOG_SEGMENTS; i++)
+			ids[i] = (unsigned char)word.segment(i)._id;
+		_segments.insert(_segments.end(), ids, ids + CATALOG_SEGMENTS);
+	}
+
+	if (_columns & kColumnStarts)
+		_starts.push_back(word.segmentStarts(orthography));
+
+	if (_columns & kColumnProbability)
+		_probability.push_back((float)probability);
+}
+
+void CatalogWriter::add(uint64 entityId, const char *name) {
+	assert(_columns == kColumnEntityIds);
+	addName(name);
+	_entityIds.push_back(entityId);
+}
+
+// Hash and displace: buckets are placed largest first, each trying pilots
+// until all its ids land on free slots. False if some bucket found none,
+// the caller then retries with another seed.
+bool CatalogWriter::buildIndex(uint64 seed, uint64 numBuckets, uint64 numSlots,
+	std::vector<unsigned short> &pilots, std::vector<uint32> &slotOf) {
+
+	uint64 n = _entityIds.size();
+	std::vector<uint64> hashes(n);
+	std::vector<uint32> bucketStart(numBuckets + 1, 0);
+
+	for (uint64 i = 0; i < n; i++) {
+		hashes[i] = catalogHash(_entityIds[i], seed);
+		bucketStart[catalogRange(hashes[i], numBuckets) + 1]++;
+	}
+
+	// ids grouped by bucket, buckets ordered by size
+	uint32 maxSize = 0;
+	for (uint64 b = 0; b < numBuckets; b++) {
+		if (bucketStart[b + 1] > maxSize)
+			maxSize = bucketStart[b + 1];
+		bucketStart[b + 1] += bucketStart[b];
+	}
+
+	// hashes are copied next to each other, so a bucket is one cache line
+	// or two however the buckets are visited
+	std::vector<uint32> members(n);
+	std::vector<uint64> grouped(n);
+	std::vector<uint32> fill(bucketStart.begin(), bucketStart.end() - 1);
+	for (uint64 i = 0; i < n; i++) {
+		uint32 at = fill[catalogRange(hashes[i], numBuckets)]++;
+		members[at] = (uint32)i;
+		grouped[at] = hashes[i];
+	}
+	std::vector<uint64>().swap(hashes);
+
+	// equal hashes in a bucket can never be placed apart
+	for (uint64 b = 0; b < numBuckets; b++) {
+		for (uint32 i = bucketStart[b] + 1; i < bucketStart[b + 1]; i++) {
+			for (uint32 j = bucketStart[b]; j < i; j++) {
+				if (grouped[i] != grouped[j])
+					continue;
+				if (_entityIds[members[i]] == _entityIds[members[j]]) {
+					char id[32];
+					sprintf(id, "%llu", _entityIds[members[i]]);
+					_error = std::string("duplicate entity id ") + id;
+				}
+				return false;
+			}
+		}
+	}
+
+	std::vector<uint32> bySize(maxSize + 2, 0);
+	for (uint64 b = 0; b < numBuckets; b++)
+		bySize[maxSize - (bucketStart[b + 1] - bucketStart[b]) + 1]++;
+	for (uint32 k = 0; k <= maxSize; k++)
+		bySize[k + 1] += bySize[k];
+	std::vector<uint32> order(numBuckets);
+	for (uint64 b = 0; b < numBuckets; b++)
+		order[bySize[maxSize - (bucketStart[b + 1] - bucketStart[b])]++] = (uint32)b;
+
+	std::vector<uint64> taken((numSlots + 63) / 64, 0);
+	std::vector<uint64> slots(maxSize);
+	pilots.assign(numBuckets, 0);
+	slotOf.assign(n, 0);
+
+	for (uint64 o = 0; o < numBuckets; o++) {
+		uint32 b = order[o];
+		const uint64 *bucket = &grouped[bucketStart[b]];
+		uint32 size = bucketStart[b + 1] - bucketStart[b];
+		if (size == 0)
+			break;
+
+		bool placed = false;
+		for (uint32 pilot = 0; pilot <= 0xFFFF && !placed; pilot++) {
+			placed = true;
+			for (uint32 i = 0; i < size && placed; i++) {
+				uint64 slot = catalogSlot(bucket[i], (unsigned short)pilot, numSlots);
+				placed = !(taken[slot >> 6] & ((uint64)1 << (slot & 63)));
+				for (uint32 j = 0; j < i && placed; j++)
+					placed = slots[j] != slot;
+				slots[i] = slot;
+			}
+
+			if (placed) {
+				pilots[b] = (unsigned short)pilot;
+				for (uint32 i = 0; i < size; i++)
+					taken[slots[i] >> 6] |= (uint64)1 << (slots[i] & 63);
+			}
+		}
+
+		if (!placed)
+			return false;
+	}
+
+	for (uint64 b = 0; b < numBuckets; b++)
+		for (uint32 i = bucketStart[b]; i < bucketStart[b + 1]; i++)
+			slotOf[members[i]] = (uint32)catalogSlot(grouped[i], pilots[b], numSlots);
+	return true;
+}
+
+// a section of the file: where it goes and what is in it, either data or
+// the blocks of arena in order
+struct Section {
+	uint64				offset;
+	const void			*data;
+	size_t				size;
+	const NameArena		*arena;
+};
+
+static uint64 checksumSection(uint64 checksum, const Section &section) {
+	if (!section.arena)
+		return fnv1a(checksum, section.data, section.size);
+	for (int b = 0; b < section.arena->numBlocks(); b++)
+		checksum = fnv1a(checksum, section.arena->blockData(b), section.arena->blockSize(b));
+	return checksum;
+}
+
+static bool writeSection(FILE *f, const Section &section) {
+	if (!section.arena)
+		return fwrite(section.data, 1, section.size, f) == section.size;
+	for (int b = 0; b < section.arena->numBlocks(); b++) {
+		size_t size = section.arena->blockSize(b);
+		if (fwrite(section.arena->blockData(b), 1, size, f) != size)
+			return false;
+	}
+	return true;
+}
+
+bool CatalogWriter::write(const char *path) {
+	if (_text.offset() >= 0xFFFFFFFFu) {
+		_error = "names too long for 32 bit offsets";
+		return false;
+	}
+
+	CatalogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CATALOG_MAGIC, 8);
+	header.version = CATALOG_VERSION;
+	header.columns = _columns;
+	header.numNames = numNames();
+
+	// with entity ids the names move to the slots of the index
+	std::vector<uint32> offsets;
+	std::vector<char> text;
+	std::vector<uint64> entityIds;
+	std::vector<unsigned short> pilots;
+
+	if (_columns & kColumnEntityIds) {
+		uint64 n = _entityIds.size();
+		uint64 numSlots = n > 0 ? (uint64)(n * CATALOG_SLACK) + 1 : 0;
+		uint64 numBuckets = n / CATALOG_BUCKET_SIZE + 1;
+		std::vector<uint32> slotOf;
+
+		if (numSlots >= 0xFFFFFFFFu || _text.offset() + numSlots >= 0xFFFFFFFFu) {
+			_error = "too many entities";
+			return false;
+		}
+
+		bool built = false;
+		_error.clear();
+		for (uint64 attempt = 0; attempt < 16 && !built && _error.empty(); attempt++) {
+			header.indexSeed = mix64(attempt + KEYED_SEED_STEP);
+			built = buildIndex(header.indexSeed, numBuckets, numSlots, pilots, slotOf);
+		}
+		if (!built) {
+			if (_error.empty())
+				_error = "cannot build the entity index";
+			return false;
+		}
+
+		std::vector<uint32> recordAt(numSlots, 0xFFFFFFFFu);
+		for (uint64 i = 0; i < n; i++)
+			recordAt[slotOf[i]] = (uint32)i;
+
+		// an empty slot holds the first id, which lives in a slot of its own
+		offsets.resize(numSlots + 1);
+		offsets[0] = 0;
+		entityIds.assign(numSlots, n > 0 ? _entityIds[0] : 0);
+		for (uint64 slot = 0; slot < numSlots; slot++) {
+			uint32 r = recordAt[slot];
+			uint32 length = r != 0xFFFFFFFFu ? _offsets[r + 1] - _offsets[r] : 1;
+			offsets[slot + 1] = offsets[slot] + length;
+			if (r != 0xFFFFFFFFu)
+				entityIds[slot] = _entityIds[r];
+		}
+
+		text.assign(offsets[numSlots], '\0');
+		for (uint64 slot = 0; slot < numSlots; slot++) {
+			uint32 r = recordAt[slot];
+			if (r != 0xFFFFFFFFu)
+				memcpy(&text[offsets[slot]], _text.at(_offsets[r]), _offsets[r + 1] - _offsets[r]);
+		}
+
+		header.numNames = numSlots;
+		header.numEntities = n;
+		header.numBuckets = numBuckets;
+	}
+
+	const std::vector<uint32> &offsetData = (_columns & kColumnEntityIds) ? offsets : _offsets;
+	bool ownText = !(_columns & kColumnEntityIds);
+	uint64 textSize = ownText ? _text.offset() : text.size();
+
+	std::vector<Section> sections;
+	uint64 end = align(sizeof(header));
+
+	const void *data[] = { &offsetData[0], text.data(), _segments.data(), _starts.data(),
+		_probability.data(), entityIds.data(), pilots.data() };
+	size_t sizes[] = { offsetData.size() * sizeof(uint32), (size_t)textSize, _segments.size(),
+		_starts.size() * sizeof(uint64), _probability.size() * sizeof(float),
+		entityIds.size() * sizeof(uint64), pilots.size() * sizeof(unsigned short) };
+	uint64 *sectionOffsets[] = { &header.offsets, &header.text, &header.segments, &header.starts,
+		&header.probability, &header.entityIds, &header.pilots };
+	uint32 sectionColumns[] = { 0, 0, kColumnSegments, kColumnStarts, kColumnProbability,
+		kColumnEntityIds, kColumnEntityIds };
+
+	for (int i = 0; i < 7; i++) {
+		if (sectionColumns[i] && !(_columns & sectionColumns[i]))
+			continue;
+
+		Section section = { end, data[i], sizes[i], i == 1 && ownText ? &_text : 0 };
+		sections.push_back(section);
+		*sectionOffsets[i] = end;
+		end = align(end + sizes[i]);
+	}
+	header.textSize = textSize;
+	header.fileSize = end;
+
+	// the checksum covers the padding too, which is written as zeros
+	static const char zeros[CATALOG_ALIGNMENT] = { 0 };
+	uint64 checksum = FNV_BASIS;
+	uint64 pos = sizeof(header);
+
+	for (size_t i = 0; i < sections.size(); i++) {
+		checksum = fnv1a(checksum, zeros, (size_t)(sections[i].offset - pos));
+		checksum = checksumSection(checksum, sections[i]);
+		pos = sections[i].offset + sections[i].size;
+	}
+	checksum = fnv1a(checksum, zeros, (size_t)(end - pos));
+	header.checksum = checksum;
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		_error = std::string("cannot create ") + path;
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	pos = sizeof(header);
+	for (size_t i = 0; i < sections.size() && ok; i++) {
+		ok = fwrite(zeros, 1, (size_t)(sections[i].offset - pos), f) == sections[i].offset - pos &&
+			writeSection(f, sections[i]);
+		pos = sections[i].offset + sections[i].size;
+	}
+	ok = ok && fwrite(zeros, 1, (size_t)(end - pos), f) == end - pos;
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok)
+		_error = std::string("cannot write ") + path;
+	return ok;
+}
+
+Catalog::Catalog() : _data(0), _size(0), _header(0), _offsets(0), _text(0),
+	_segments(0), _starts(0), _probability(0), _entityIds(0), _pilots(0), _mapped(false) {
+}
+
+Catalog::~Catalog() {
+	close();
+}
+
+bool Catalog::fail(const std::string &message) {
+	close();
+	_error = message;
+	return false;
+}
+
+void Catalog::close() {
+	if (_data) {
+#ifdef _WIN32
+		free((void *)_data);
+#else
+		if (_mapped)
+			munmap((void *)_data, (size_t)_size);
+		else
+			delete[] _data;
+#endif
+	}
+
+	_data = 0;
+	_size = 0;
+	_header = 0;
+	_pilots = 0;
+	_mapped = false;
+}
+
+bool Catalog::open(const char *path) {
+	close();
+
+#ifdef _WIN32
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return fail(std::string("cannot open ") + path);
+	fseek(f, 0, SEEK_END);
+	_size = (uint64)ftell(f);
+	fseek(f, 0, SEEK_SET);
+	char *buffer = (char *)malloc((size_t)_size + 1);
+	bool read = buffer && fread(buffer, 1, (size_t)_size, f) == _size;
+	fclose(f);
+	_data = buffer;
+	if (!read)
+		return fail(std::string("cannot read ") + path);
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return fail(std::string("cannot open ") + path);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CatalogHeader)) {
+		::close(fd);
+		return fail(std::string("not a catalog: ") + path);
+	}
+
+	_size = (uint64)st.st_size;
+	void *data = mmap(0, (size_t)_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+		return fail(std::string("cannot map ") + path);
+	_data = (const char *)data;
+	_mapped = true;
+#endif
+
+	if (_size < sizeof(CatalogHeader))
+		return fail(std::string("not a catalog: ") + path);
+
+	const CatalogHeader *header = (const CatalogHeader *)_data;
+	if (memcmp(header->magic, CATALOG_MAGIC, 8) != 0)
+		return fail(std::string("not a catalog: ") + path);
+	if (header->version != CATALOG_VERSION)
+		return fail(std::string("unsupported catalog version: ") + path);
+	if (header->fileSize != _size)
+		return fail(std::string("truncated catalog: ") + path);
+
+	uint64 n = header->numNames;
+	struct {
+		uint64	offset;
+		uint64	size;
+		uint32	column;
+	} sections[] = {
+		{ header->offsets, (n + 1) * sizeof(uint32), 0 },
+		{ header->text, header->textSize, 0 },
+		{ header->segments, n * CATALOG_SEGMENTS, kColumnSegments },
+		{ header->starts, n * sizeof(uint64), kColumnStarts },
+		{ header->probability, n * sizeof(float), kColumnProbability },
+		{ header->entityIds, n * sizeof(uint64), kColumnEntityIds },
+		{ header->pilots, header->numBuckets * sizeof(unsigned short), kColumnEntityIds },
+	};
+
+	if ((header->columns & kColumnEntityIds) && (header->numBuckets == 0 || header->numBuckets > _size ||
+		n >= 0xFFFFFFFFu || header->numEntities > n))
+		return fail(std::string("corrupt catalog: ") + path);
+
+	for (int i = 0; i < 7; i++) {
+		if (sections[i].column && !(header->columns & sections[i].column))
+			continue;
+		if (n > _size || sections[i].offset % CATALOG_ALIGNMENT != 0 || sections[i].offset < sizeof(CatalogHeader) ||
+			sections[i].offset > _size || sections[i].size > _size - sections[i].offset)
+			return fail(std::string("corrupt catalog: ") + path);
+	}
+
+	_header = header;
+	_offsets = (const uint32 *)(_data + header->offsets);
+	_text = _data + header->text;
+	_segments = hasColumn(kColumnSegments) ? (const unsigned char *)(_data + header->segments) : 0;
+	_starts = hasColumn(kColumnStarts) ? (const uint64 *)(_data + header->starts) : 0;
+	_probability = hasColumn(kColumnProbability) ? (const float *)(_data + header->probability) : 0;
+	_entityIds = hasColumn(kColumnEntityIds) ? (const uint64 *)(_data + header->entityIds) : 0;
+	_pilots = hasColumn(kColumnEntityIds) ? (const unsigned short *)(_data + header->pilots) : 0;
+
+	if (_offsets[n] != header->textSize)
+		return fail(std::string("corrupt catalog: ") + path);
+
+	_error.clear();
+	return true;
+}
+
+bool Catalog::verify() {
+	if (!_header) {
+		_error = "no catalog open";
+		return false;
+	}
+
+	uint64 checksum = fnv1a(FNV_BASIS, _data + sizeof(CatalogHeader), (size_t)(_size - sizeof(CatalogHeader)));
+	if (checksum != _header->checksum) {
+		_error = "catalog checksum mismatch";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,208 @@
+#ifndef __CATALOG__
+#define __CATALOG__
+
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "misc.h"
+#include "word.h"
+
+#define CATALOG_MAGIC		"PERESCAT"
+#define CATALOG_VERSION		2
+
+// sections start on cache line boundaries
+#define CATALOG_ALIGNMENT	64
+
+// segment ids per name in the segments column, 0 padded
+#define CATALOG_SEGMENTS	16
+
+// entity index: average ids per bucket, and slots per id
+#define CATALOG_BUCKET_SIZE	3
+#define CATALOG_SLACK		1.02
+
+enum CatalogColumns {
+	kColumnSegments		= 1,		// CATALOG_SEGMENTS unsigned chars per name
+	kColumnStarts		= 2,		// uint64 per name, see Word::segmentStarts()
+	kColumnProbability	= 4,		// float per name, see EnglishWordGenerator::probability()
+	kColumnEntityIds	= 8			// uint64 per name, plus the index finding them
+};
+
+// The file starts with this header, all numbers little endian. Offsets are
+// from the start of the file; a column is absent when its offset is 0.
+//
+//   offsets      numNames + 1 uint32, name i is text[offsets[i]] up to
+//                text[offsets[i + 1] - 1], which is its terminating 0
+//   text         the names, UTF-8 and 0 terminated
+//   columns      one fixed size record per name each
+//   pilots       numBuckets unsigned shorts of the entity index
+//
+// With entity ids the names are stored in the order of a perfect hash of
+// the ids: an id hashes to a bucket, the bucket's pilot to one slot, which
+// is the index of the name. A few slots are left over and hold an empty
+// name; comparing the stored id tells those and unknown ids apart.
+//
+// checksum is FNV-1a over everything after the header.
+struct CatalogHeader {
+	char	magic[8];
+	uint32	version;
+	uint32	columns;
+	uint64	numNames;
+	uint64	fileSize;
+	uint64	offsets;
+	uint64	text;
+	uint64	textSize;
+	uint64	segments;
+	uint64	starts;
+	uint64	probability;
+	uint64	entityIds;
+	uint64	pilots;
+	uint64	numEntities;
+	uint64	numBuckets;
+	uint64	indexSeed;
+	uint64	checksum;
+};
+
+// maps a 64 bit hash onto [0, n), n below 2^32
+inline uint64 catalogRange(uint64 hash, uint64 n) {
+	return ((hash >> 32) * n) >> 32;
+}
+
+inline uint64 catalogHash(uint64 entityId, uint64 seed) {
+	return mix64(entityId ^ seed);
+}
+
+inline uint64 catalogSlot(uint64 hash, unsigned short pilot, uint64 numSlots) {
+	return catalogRange(mix64(hash ^ mix64(pilot + 1)), numSlots);
+}
+
+// Collects names and writes them as a catalog.
+class CatalogWriter {
+
+	uint32						_columns;
+	std::vector<uint32>			_offsets;
+	NameArena					_text;
+	std::vector<unsigned char>	_segments;
+	std::vector<uint64>			_starts;
+	std::vector<float>			_probability;
+	std::vector<uint64>			_entityIds;
+	std::string					_error;
+
+	void addName(const char *name);
+	bool buildIndex(uint64 seed, uint64 numBuckets, uint64 numSlots,
+		std::vector<unsigned short> &pilots, std::vector<uint32> &slotOf);
+
+public:
+	// hugePages backs the name text with huge pages, see NameArena
+	CatalogWriter(uint32 columns, bool hugePages = false) : _columns(columns), _text(hugePages) {
+		_offsets.push_back(0);
+	}
+
+	uint64 numNames() const {
+		return _offsets.size() - 1;
+	}
+
+	// name is the word rendered with the given orthography, 0 for the
+	// segment table
+	void add(const char *name, const Word &word, const Orthography *orthography, double probability);
+
+	// for catalogs with kColumnEntityIds only; ids must be unique
+	void add(uint64 entityId, const char *name);
+
+	bool write(const char *path);
+
+	const std::string &error() const {
+		return _error;
+	}
+};
+
+// A catalog mapped into memory; names are read in place, so any number of
+// processes share one copy through the page cache.
+class Catalog {
+
+	const char				*_data;
+	uint64					_size;
+	const CatalogHeader		*_header;
+	const uint32			*_offsets;
+	const char				*_text;
+	const unsigned char		*_segments;
+	const uint64			*_starts;
+	const float				*_probability;
+	const uint64			*_entityIds;
+	const unsigned short	*_pilots;
+	bool					_mapped;
+	std::string				_error;
+
+	bool fail(const std::string &message);
+
+public:
+	Catalog();
+	~Catalog();
+
+	// maps the file and checks the header and section bounds; the checksum
+	// is only checked by verify(), which reads the whole file
+	bool open(const char *path);
+	void close();
+	bool verify();
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	// with entity ids this counts the empty slots too
+	uint64 numNames() const {
+		return _header ? _header->numNames : 0;
+	}
+
+	uint64 numEntities() const {
+		return _header ? _header->numEntities : 0;
+	}
+
+	bool hasColumn(uint32 column) const {
+		return _header && (_header->columns & column) != 0;
+	}
+
+	const char *name(uint64 i) const {
+		return _text + _offsets[i];
+	}
+
+	int nameLength(uint64 i) const {
+		return (int)(_offsets[i + 1] - _offsets[i] - 1);
+	}
+
+	// CATALOG_SEGMENTS ids, 0 after the last segment
+	const unsigned char *segments(uint64 i) const {
+		return _segments + i * CATALOG_SEGMENTS;
+	}
+
+	uint64 starts(uint64 i) const {
+		return _starts[i];
+	}
+
+	float probability(uint64 i) const {
+		return _probability[i];
+	}
+
+	// index of the entity's name; needs kColumnEntityIds
+	bool find(uint64 entityId, uint64 &index) const {
+		if (!_pilots || _header->numNames == 0)
+			return false;
+
+		uint64 hash = catalogHash(entityId, _header->indexSeed);
+		uint64 bucket = catalogRange(hash, _header->numBuckets);
+		index = catalogSlot(hash, _pilots[bucket], _header->numNames);
+		return _entityIds[index] == entityId;
+	}
+
+	NameRef lookup(uint64 entityId) const {
+		NameRef ref = { 0, 0 };
+		uint64 slot;
+		if (find(entityId, slot)) {
+			ref.text = name(slot);
+			ref.length = nameLength(slot);
+		}
+		return ref;
+	}
+};
+
+#endif
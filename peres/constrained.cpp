@@ -0,0 +1,305 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "constrained.h"
+
+ConstrainedGenerator::ConstrainedGenerator(const NameConstraints &constraints, const Orthography *orthography) :
+	_constraints(constraints), _blocklist(0), _orthography(orthography), _numStates(0) {
+
+	en_setupOnsets(_onsets);
+	en_setupNuclei(_nuclei);
+	en_setupCodas(_codas);
+
+	NameConstraints &c = _constraints;
+	if (c.maxLength > MAX_NAME_LEN - 1)
+		c.maxLength = MAX_NAME_LEN - 1;
+	if (c.minLength < 0)
+		c.minLength = 0;
+	if (c.numSyllables < 1)
+		c.numSyllables = 1;
+	if (c.numSyllables > MAX_SYLLABLES)
+		c.numSyllables = MAX_SYLLABLES;
+
+	_prefixLength = 0;
+	if (c.prefix) {
+		while (c.prefix[_prefixLength] && _prefixLength < MAX_NAME_LEN - 1) {
+			_prefix[_prefixLength] = (char)tolower((unsigned char)c.prefix[_prefixLength]);
+			_prefixLength++;
+		}
+	}
+	_prefix[_prefixLength] = '\0';
+
+	// names shorter than the prefix cannot start with it
+	if (c.minLength < _prefixLength)
+		c.minLength = _prefixLength;
+
+	// open syllables are onset + nucleus, the last one gets a coda too
+	int numSlots = 2 * c.numSyllables + 1;
+	int numLengths = c.maxLength + 1;
+	int rows = 0;
+	int k, len, i;
+
+	_slots.resize(numSlots);
+	for (k = 0; k < numSlots; k++) {
+		Slot &slot = _slots[k];
+		slot.dist = (k == numSlots - 1) ? &_codas : ((k & 1) ? &_nuclei : &_onsets);
+		slot.offset = rows;
+		for (i = 0; i < slot.dist->size(); i++)
+			slot.length.push_back((int)strlen(slot.dist->item(i)._spelling));
+		rows += slot.dist->size() * numLengths;
+	}
+
+	if (_orthography) {
+		buildSpelled();
+		return;
+	}
+
+	// completions(numSlots, len) is 1 for every acceptable final length,
+	// earlier slots sum over their items
+	_completions.assign((numSlots + 1) * numLengths, 0.0);
+	for (len = c.minLength; len < numLengths; len++)
+		_completions[numSlots * numLengths + len] = 1.0;
+
+	_cumWeights.assign(rows, 0.0);
+	for (k = numSlots - 1; k >= 0; k--) {
+		const Slot &slot = _slots[k];
+		int n = slot.dist->size();
+
+		for (len = 0; len < numLengths; len++) {
+			double *cum = &_cumWeights[slot.offset + len * n];
+			double total = 0.0;
+
+			for (i = 0; i < n; i++) {
+				int next = len + slot.length[i];
+				if (next < numLengths && matchesPrefix(slot.dist->item(i)._spelling, len))
+					total += slot.dist->frequency(i) * completions(k + 1, next);
+				cum[i] = total;
+			}
+
+			_completions[k * numLengths + len] = total;
+		}
+	}
+}
+
+bool ConstrainedGenerator::matchesPrefix(const char *spelling, int position) const {
+	for (int i = position; i < _prefixLength && *spelling; i++, spelling++) {
+		if (*spelling != _prefix[i])
+			return false;
+	}
+	return true;
+}
+
+double ConstrainedGenerator::completions(int slot, int length) const {
+	return _completions[slot * (_constraints.maxLength + 1) + length];
+}
+
+bool ConstrainedGenerator::feasible() const {
+	if (_orthography)
+		return _spelled[startState()] > 0.0;
+	return completions(0, 0) > 0.0;
+}
+
+int ConstrainedGenerator::drawItem(int slot, int length, Seed &seed) const {
+	const Slot &s = _slots[slot];
+	int n = s.dist->size();
+	const double *cum = &_cumWeights[s.offset + length * n];
+
+	double u = (seed.getBits(1 << 30) + 0.5) / (double)(1 << 30) * cum[n - 1];
+
+	// first item whose cumulative weight exceeds u; zero weight items
+	// never win since they do not raise the running total
+	int lo = 0, hi = n - 1;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (cum[mid] > u)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+int ConstrainedGenerator::slotOf(int slot) const {
+	if (slot == (int)_slots.size() - 1)
+		return kSlotCoda;
+	return (slot & 1) ? kSlotNucleus : kSlotOnset;
+}
+
+// nothing spelled yet, nothing pending
+int ConstrainedGenerator::startState() const {
+	int boundary = _orthography->boundary();
+	return _orthography->leftClass(boundary) * (boundary + 1) + boundary;
+}
+
+// the state after item fills slot: the pending segment is spelled now that
+// its right neighbour is known and item waits in its place; -1 if that
+// spelling breaks the prefix or the length limit
+int ConstrainedGenerator::nextState(int slot, int state, const Segment &item) const {
+	if (item._numItems == 0)
+		return state;
+
+	int boundary = _orthography->boundary();
+	int numLeft = _orthography->numLeftClasses();
+	int pending = state % (boundary + 1);
+	int left = state / (boundary + 1) % numLeft;
+	int length = state / (boundary + 1) / numLeft;
+	int symbol = _orthography->symbol(slotOf(slot), item._id);
+
+	if (pending != boundary) {
+		const char *text;
+		int n = _orthography->spellingAfter(left, pending, symbol, text);
+		if (length + n > _constraints.maxLength || !matchesPrefix(text, length))
+			return -1;
+		length += n;
+	}
+	return (length * numLeft + _orthography->leftClass(pending)) * (boundary + 1) + symbol;
+}
+
+// a complete word ends in state: spells the pending segment before the
+// boundary and checks the final length
+bool ConstrainedGenerator::acceptsState(int state) const {
+	int boundary = _orthography->boundary();
+	int numLeft = _orthography->numLeftClasses();
+	int pending = state % (boundary + 1);
+	int left = state / (boundary + 1) % numLeft;
+	int length = state / (boundary + 1) / numLeft;
+
+	if (pending != boundary) {
+		const char *text;
+		int n = _orthography->spellingAfter(left, pending, boundary, text);
+		if (!matchesPrefix(text, length))
+			return false;
+		length += n;
+	}
+	return length >= _constraints.minLength && length <= _constraints.maxLength;
+}
+
+void ConstrainedGenerator::buildSpelled() {
+	int numSlots = (int)_slots.size();
+	_numStates = (_constraints.maxLength + 1) * _orthography->numLeftClasses() * (_orthography->boundary() + 1);
+	_spelled.assign((size_t)(numSlots + 1) * _numStates, -1.0);
+
+	// marks the reachable states with 0
+	_spelled[startState()] = 0.0;
+	for (int k = 0; k < numSlots; k++) {
+		const SegmentDistribution &dist = *_slots[k].dist;
+		const double *from = &_spelled[(size_t)k * _numStates];
+		double *to = &_spelled[(size_t)(k + 1) * _numStates];
+
+		for (int state = 0; state < _numStates; state++) {
+			if (from[state] < 0.0)
+				continue;
+			for (int i = 0; i < dist.size(); i++) {
+				int next = nextState(k, state, dist.item(i));
+				if (next >= 0)
+					to[next] = 0.0;
+			}
+		}
+	}
+
+	double *last = &_spelled[(size_t)numSlots * _numStates];
+	for (int state = 0; state < _numStates; state++) {
+		if (last[state] == 0.0 && acceptsState(state))
+			last[state] = 1.0;
+	}
+
+	for (int k = numSlots - 1; k >= 0; k--) {
+		const SegmentDistribution &dist = *_slots[k].dist;
+		double *weights = &_spelled[(size_t)k * _numStates];
+		const double *after = &_spelled[(size_t)(k + 1) * _numStates];
+
+		for (int state = 0; state < _numStates; state++) {
+			if (weights[state] < 0.0)
+				continue;
+			double total = 0.0;
+			for (int i = 0; i < dist.size(); i++) {
+				int next = nextState(k, state, dist.item(i));
+				if (next >= 0)
+					total += dist.frequency(i) * after[next];
+			}
+			weights[state] = total;
+		}
+	}
+}
+
+// an item of slot in proportion to frequency times the completion weight
+// it leaves, state must have some
+int ConstrainedGenerator::drawSpelled(int slot, int state, Seed &seed) const {
+	const SegmentDistribution &dist = *_slots[slot].dist;
+	const double *after = &_spelled[(size_t)(slot + 1) * _numStates];
+
+	double u = (seed.getBits(1 << 30) + 0.5) / (double)(1 << 30) * _spelled[(size_t)slot * _numStates + state];
+	double total = 0.0;
+	int chosen = -1;
+	for (int i = 0; i < dist.size(); i++) {
+		int next = nextState(slot, state, dist.item(i));
+		if (next < 0 || after[next] <= 0.0)
+			continue;
+		total += dist.frequency(i) * after[next];
+		chosen = i;
+		if (total > u)
+			break;
+	}
+	return chosen;
+}
+
+bool ConstrainedGenerator::generate(char *buffer, Seed &seed) const {
+	if (!feasible())
+		return false;
+
+	int numSyllables = _constraints.numSyllables;
+	Syllable syl[MAX_SYLLABLES];
+
+	for (int attempt = 0; attempt < MAX_CONSTRAINED_ATTEMPTS; attempt++) {
+		int length = 0, state = _orthography ? startState() : 0, k = 0;
+		bool valid = true;
+
+		// the next slot's segment, by spelled or table length
+		auto draw = [&]() -> const Segment & {
+			const Slot &slot = _slots[k];
+			if (_orthography) {
+				const Segment &item = slot.dist->item(drawSpelled(k, state, seed));
+				state = nextState(k++, state, item);
+				return item;
+			}
+			int i = drawItem(k++, length, seed);
+			length += slot.length[i];
+			return slot.dist->item(i);
+		};
+
+		for (int j = 0; j < numSyllables; j++) {
+			Syllable &s = syl[j];
+			s.onset = draw();
+			s.nucleus = draw();
+			if (j == numSyllables - 1)
+				s.coda = draw();
+			else
+				s.coda = Segment();
+
+			valid = valid && EnglishSyllableGenerator::validateSyllable(s);
+		}
+
+		if (!valid)
+			continue;
+
+		Word word(syl, numSyllables);
+		if (!word.validate())
+			continue;
+
+		char name[MAX_NAME_LEN];
+		if (_orthography) {
+			word.render(name, *_orthography);
+			if (_blocklist && _blocklist->contains(name))
+				continue;
+		} else if (!_blocklist) {
+			word.render(buffer);
+			return true;
+		} else if (!word.render(name, *_blocklist)) {
+			continue;
+		}
+		strcpy(buffer, name);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,97 @@
+#ifndef __CONSTRAINED__
+#define __CONSTRAINED__
+
+#include <vector>
+
+#include "misc.h"
+#include "blocklist.h"
+#include "generator.h"
+#include "orthography.h"
+
+// give up on constraint sets whose words (nearly) always fail validation
+#define MAX_CONSTRAINED_ATTEMPTS	100000
+
+struct NameConstraints {
+	const char	*prefix;		// the rendered name must start with it, 0 for any
+	int			minLength;		// bounds on the rendered length, inclusive
+	int			maxLength;
+	int			numSyllables;	// open syllables followed by a closed one
+
+	NameConstraints() : prefix(0), minLength(0), maxLength(MAX_NAME_LEN - 1), numSyllables(2) {
+	}
+};
+
+// Samples words from the onset/nucleus/coda tables conditioned on a prefix,
+// a rendered length range and a syllable count, without drawing and
+// discarding mismatches.
+//
+// A DP over (slot, rendered length) counts the weight of all completions
+// that still satisfy the constraints; each slot then draws its segment with
+// probability proportional to frequency times the completion weight of what
+// it leaves behind. The tables are precomputed per constraint set, so a draw
+// is one binary search per slot. Only the phonotactic checks are still done
+// by rejection, which keeps the result the exact conditional distribution.
+//
+// With an orthography a segment's spelling depends on its neighbours, so
+// the DP state also holds the last segment, whose spelling waits for the
+// next one, and the class of the one before it. Only the states reachable
+// from the start are computed, and each draw weighs the items of its slot
+// on the spot.
+class ConstrainedGenerator {
+
+	struct Slot {
+		const SegmentDistribution	*dist;
+		std::vector<int>			length;		// strlen of each item's spelling
+		int							offset;		// first cumulative row of this slot
+	};
+
+	SegmentDistribution		_onsets;
+	SegmentDistribution		_nuclei;
+	SegmentDistribution		_codas;
+
+	NameConstraints			_constraints;
+	const Blocklist			*_blocklist;
+	char					_prefix[MAX_NAME_LEN];
+	int						_prefixLength;
+
+	std::vector<Slot>		_slots;
+	std::vector<double>		_completions;	// [slot][length]
+	std::vector<double>		_cumWeights;	// [slot][length][item]
+
+	// orthographic spelling, states are (length, left class, pending symbol)
+	const Orthography		*_orthography;
+	int						_numStates;
+	std::vector<double>		_spelled;		// [slot][state] completion weight, -1 unreachable
+
+	bool matchesPrefix(const char *spelling, int position) const;
+	double completions(int slot, int length) const;
+	int drawItem(int slot, int length, Seed &seed) const;
+
+	int slotOf(int slot) const;
+	int startState() const;
+	int nextState(int slot, int state, const Segment &item) const;
+	bool acceptsState(int state) const;
+	void buildSpelled();
+	int drawSpelled(int slot, int state, Seed &seed) const;
+
+public:
+	// spells the rendered names with orthography if it is not 0; it must
+	// outlive the generator
+	ConstrainedGenerator(const NameConstraints &constraints, const Orthography *orthography = 0);
+
+	// rejects words containing a blocked substring like validation does,
+	// 0 for none
+	void setBlocklist(const Blocklist *blocklist) {
+		_blocklist = blocklist;
+	}
+
+	// false when no word can satisfy the constraints
+	bool feasible() const;
+
+	// draws until a candidate passes validation and renders it; returns
+	// false without touching buffer if the constraints are infeasible or
+	// nothing valid turned up in MAX_CONSTRAINED_ATTEMPTS draws
+	bool generate(char *buffer, Seed &seed) const;
+};
+
+#endif
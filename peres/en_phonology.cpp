@@ -2,6 +2,9 @@
 #include "en_phonology.h"
 #include "tactics.h"
 #include "misc.h"
+#include "phonotactics.h"
+#include "orthography.h"
+#include "positions.h"
 
 typedef Distribution<Segment> SegmentDistribution;
 
@@ -248,11 +251,229 @@ static Segment seg_nasal_plus_plosive_plus_fricative_1( "ngth",  c_n, c_g, c_th0
 static Segment seg_three_obstruent_0( "xth",  c_k, c_s, c_th0 );
 static Segment seg_three_obstruent_1( "xt",  c_k, c_s, c_t );
 
-
 static Segment seg_null;
 
+// every segment above, Segment::_id is the position in this table
+static Segment *segments[] = {
+	&seg_null,
+	&seg_sv_i,
+	&seg_sv_u,
+	&seg_sv_e0,
+	&seg_sv_e1,
+	&seg_sv_a0,
+	&seg_sv_a1,
+	&seg_sv_o,
+	&seg_lv_i,
+	&seg_lv_u,
+	&seg_lv_e,
+	&seg_lv_o,
+	&seg_lv_a,
+	&seg_diph_ei,
+	&seg_diph_ou,
+	&seg_diph_ai,
+	&seg_diph_au,
+	&seg_diph_oi,
+	&seg_diph_uschwa,
+	&seg_diph_eschwa,
+	&seg_c_p,
+	&seg_c_b,
+	&seg_c_t,
+	&seg_c_d,
+	&seg_c_k,
+	&seg_c_g,
+	&seg_c_m,
+	&seg_c_n,
+	&seg_c_ng,
+	&seg_c_f,
+	&seg_c_v,
+	&seg_c_th0,
+	&seg_c_s,
+	&seg_c_z,
+	&seg_c_sh,
+	&seg_c_zh,
+	&seg_c_h,
+	&seg_c_ch,
+	&seg_c_ge,
+	&seg_c_r,
+	&seg_c_j,
+	&seg_c_l,
+	&seg_plosive_plus_approx_0,
+	&seg_plosive_plus_approx_1,
+	&seg_plosive_plus_approx_2,
+	&seg_plosive_plus_approx_3,
+	&seg_plosive_plus_approx_4,
+	&seg_plosive_plus_approx_5,
+	&seg_plosive_plus_approx_6,
+	&seg_plosive_plus_approx_7,
+	&seg_plosive_plus_approx_8,
+	&seg_plosive_plus_approx_9,
+	&seg_plosive_plus_approx_10,
+	&seg_plosive_plus_approx_11,
+	&seg_plosive_plus_approx_12,
+	&seg_plosive_plus_approx_13,
+	&seg_voiceless_fricative_plus_approx_0,
+	&seg_voiceless_fricative_plus_approx_1,
+	&seg_voiceless_fricative_plus_approx_2,
+	&seg_voiceless_fricative_plus_approx_3,
+	&seg_voiceless_fricative_plus_approx_4,
+	&seg_voiceless_fricative_plus_approx_5,
+	&seg_voiceless_fricative_plus_approx_6,
+	&seg_consonant_plus_j_0,
+	&seg_consonant_plus_j_1,
+	&seg_consonant_plus_j_2,
+	&seg_consonant_plus_j_3,
+	&seg_consonant_plus_j_4,
+	&seg_consonant_plus_j_5,
+	&seg_consonant_plus_j_6,
+	&seg_consonant_plus_j_7,
+	&seg_consonant_plus_j_8,
+	&seg_consonant_plus_j_9,
+	&seg_consonant_plus_j_10,
+	&seg_consonant_plus_j_11,
+	&seg_consonant_plus_j_12,
+	&seg_consonant_plus_j_13,
+	&seg_consonant_plus_j_14,
+	&seg_s_plus_voiceless_plosive_plus_approx_0,
+	&seg_s_plus_voiceless_plosive_plus_approx_1,
+	&seg_s_plus_voiceless_plosive_plus_approx_2,
+	&seg_s_plus_voiceless_plosive_plus_approx_3,
+	&seg_s_plus_voiceless_plosive_plus_approx_4,
+	&seg_s_plus_voiceless_plosive_plus_approx_5,
+	&seg_s_plus_voiceless_plosive_plus_approx_6,
+	&seg_s_plus_voiceless_plosive_plus_approx_7,
+	&seg_s_plus_voiceless_plosive_plus_approx_8,
+	&seg_s_plus_voiceless_plosive_plus_approx_9,
+	&seg_s_plus_voiceless_plosive_0,
+	&seg_s_plus_voiceless_plosive_1,
+	&seg_s_plus_voiceless_plosive_2,
+	&seg_s_plus_nasal_0,
+	&seg_s_plus_nasal_1,
+	&seg_s_plus_voiceless_fricative_0,
+	&seg_lateral_plus_plosive_0,
+	&seg_lateral_plus_plosive_1,
+	&seg_lateral_plus_plosive_2,
+	&seg_lateral_plus_plosive_3,
+	&seg_lateral_plus_plosive_4,
+	&seg_lateral_plus_fricative_0,
+	&seg_lateral_plus_fricative_1,
+	&seg_lateral_plus_fricative_2,
+	&seg_lateral_plus_fricative_3,
+	&seg_lateral_plus_fricative_4,
+	&seg_lateral_plus_affricate_0,
+	&seg_lateral_plus_affricate_1,
+	&seg_lateral_plus_nasal_0,
+	&seg_lateral_plus_nasal_1,
+	&seg_nasal_plus_plosive_0,
+	&seg_nasal_plus_plosive_1,
+	&seg_nasal_plus_plosive_2,
+	&seg_nasal_plus_plosive_3,
+	&seg_nasal_plus_fricative_0,
+	&seg_nasal_plus_fricative_1,
+	&seg_nasal_plus_fricative_2,
+	&seg_nasal_plus_fricative_3,
+	&seg_nasal_plus_fricative_4,
+	&seg_nasal_plus_fricative_5,
+	&seg_nasal_plus_affricate_0,
+	&seg_nasal_plus_affricate_1,
+	&seg_voiceless_fricative_plus_voiceless_plosive_0,
+	&seg_voiceless_fricative_plus_voiceless_plosive_1,
+	&seg_voiceless_fricative_plus_voiceless_plosive_2,
+	&seg_voiceless_fricative_plus_voiceless_plosive_3,
+	&seg_voiceless_fricative_plus_voiceless_fricative_0,
+	&seg_voiceless_plosive_plus_voiceless_plosive_0,
+	&seg_voiceless_plosive_plus_voiceless_plosive_1,
+	&seg_plosive_plus_voiceless_fricative_0,
+	&seg_plosive_plus_voiceless_fricative_1,
+	&seg_plosive_plus_voiceless_fricative_2,
+	&seg_plosive_plus_voiceless_fricative_3,
+	&seg_plosive_plus_voiceless_fricative_4,
+	&seg_plosive_plus_voiceless_fricative_5,
+	&seg_plosive_plus_voiceless_fricative_6,
+	&seg_lateral_plus_two_consonants_0,
+	&seg_lateral_plus_two_consonants_1,
+	&seg_lateral_plus_two_consonants_2,
+	&seg_lateral_plus_two_consonants_3,
+	&seg_lateral_plus_two_consonants_4,
+	&seg_lateral_plus_two_consonants_5,
+	&seg_nasal_plus_two_plosives_0,
+	&seg_nasal_plus_two_plosives_1,
+	&seg_nasal_plus_two_plosives_2,
+	&seg_nasal_plus_two_plosives_3,
+	&seg_nasal_plus_plosive_plus_fricative_0,
+	&seg_nasal_plus_plosive_plus_fricative_1,
+	&seg_three_obstruent_0,
+	&seg_three_obstruent_1,
+};
+
+static int assignSegmentIds() {
+	int size = sizeof(segments) / sizeof(segments[0]);
+	for (int i = 0; i < size; i++)
+		segments[i]->_id = i;
+	return size;
+}
+
+const SegmentInventory &en_inventory() {
+	// ids have to be in place before the tables copy the segments
+	static const SegmentInventory inventory = { segments, assignSegmentIds() };
+	return inventory;
+}
+
+// The English phonotactics, see phonotactics.h for the rule language.
+static const char en_rules[] =
+	"# 's'C1VC2 where V is a short vowel and C1, C2 are the same phoneme\n"
+	"forbid onset,first:FRICATIVE|ALVEOLAR|VOICELESS,last=$1 nucleus,single,SHORT_VOWEL coda,first=$1\n"
+	"\n"
+	"# glottals only at the very start of the word\n"
+	"forbid _ single,GLOTTAL\n"
+	"\n"
+	"# complex clusters\n"
+	"limit 2 cluster\n"
+	"limit 1 cluster\n"
+	"\n"
+	"# the same segment twice in a row\n"
+	"norepeat\n"
+	"\n"
+	"# cacophony\n"
+	"maxcount 2 consonant\n"
+	"maxcount 3 vowel\n";
+
+const Phonotactics &en_phonotactics() {
+	static Phonotactics rules;
+	static bool compiled = rules.compile(en_rules, en_inventory());
+
+	assert(compiled);
+	(void)compiled;
+	return rules;
+}
+
+// Spellings depending on the neighbours, see orthography.h for the rules.
+static const char en_spellings[] =
+	"# labiovelar clusters\n"
+	"spell onset,last:LABIOVELAR,'k' qu\n"
+	"spell onset,last:LABIOVELAR,'sk' squ\n"
+	"spell onset,last:LABIOVELAR,'gh' gu\n"
+	"\n"
+	"# hard c before back vowels, ck after a short one at the end\n"
+	"spell onset,single,all:VELAR|PLOSIVE|VOICELESS c / _ 'a*|o*|u*'\n"
+	"spell coda,single,all:VELAR|PLOSIVE|VOICELESS ck / nucleus,single,SHORT_VOWEL _ #\n"
+	"\n"
+	"# the zh sound at the edges of the word\n"
+	"spell single,all:POSTALVEOLAR|FRICATIVE|VOICED zh / # _\n"
+	"spell coda,single,all:POSTALVEOLAR|FRICATIVE|VOICED ge / _ #\n";
+
+const Orthography &en_orthography() {
+	static Orthography orthography;
+	static bool compiled = orthography.compile(en_spellings, en_phonotactics());
+
+	assert(compiled);
+	(void)compiled;
+	return orthography;
+}
+
 void en_setupOnsets(SegmentDistribution &dist) {
 
+	en_inventory();
+
 	dist.addItem( 30, seg_null);
 	dist.addItem( 30, seg_c_p );
 	dist.addItem( 30, seg_c_b );
@@ -333,6 +554,8 @@ void en_setupOnsets(SegmentDistribution &dist) {
 
 void en_setupCodas(SegmentDistribution &dist) {
 
+	en_inventory();
+
 	dist.addItem( 15, seg_null);
 	dist.addItem( 30, seg_c_p );
 	dist.addItem( 30, seg_c_b );
@@ -414,6 +637,8 @@ void en_setupCodas(SegmentDistribution &dist) {
 
 void en_setupNuclei(SegmentDistribution &dist) {
 
+	en_inventory();
+
 	dist.addItem( 10, seg_sv_i );
 	dist.addItem( 10, seg_sv_u );
 	dist.addItem( 10, seg_sv_e0 );
@@ -435,3 +660,16 @@ void en_setupNuclei(SegmentDistribution &dist) {
 	dist.addItem( 1, seg_diph_eschwa );
 
 }
+
+static PositionalTables buildPositionalTables() {
+	SegmentDistribution dists[kNumSlots];
+	en_setupOnsets(dists[kSlotOnset]);
+	en_setupNuclei(dists[kSlotNucleus]);
+	en_setupCodas(dists[kSlotCoda]);
+	return PositionalTables(en_phonotactics(), dists);
+}
+
+const PositionalTables &en_positionalTables() {
+	static const PositionalTables tables = buildPositionalTables();
+	return tables;
+}
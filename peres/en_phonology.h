@@ -5,6 +5,10 @@
 
 #include "phonetics.h"
 
+class Phonotactics;
+class Orthography;
+class PositionalTables;
+
 enum EnglishPhonemes {
 
 	SHORTVOWEL_I = 1,
@@ -48,4 +52,9 @@ enum EnglishPhonemes {
 	CONSONANT_L
 };
 
+const SegmentInventory &en_inventory();
+const Phonotactics &en_phonotactics();
+const Orthography &en_orthography();
+const PositionalTables &en_positionalTables();
+
 #endif
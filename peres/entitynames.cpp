@@ -0,0 +1,165 @@
+#include <assert.h>
+
+#include "entitynames.h"
+#include "generator.h"
+#include "family.h"
+#include "mixture.h"
+
+// draws taken by an open + closed word that is accepted on the first try
+#define NAME_PREFETCH_DRAWS		5
+#define NAME_BLOCK				16
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NAMES_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+static const EnglishWordGenerator &sharedGenerator() {
+	// only ever used through the const, seed taking entry points
+	static NullSeed nullSeed;
+	static const EnglishWordGenerator gen(nullSeed, nullSeed);
+	return gen;
+}
+
+uint64 entityKey(uint64 galaxySeed, uint64 entityId) {
+	return mix64(galaxySeed ^ mix64(entityId + KEYED_SEED_STEP));
+}
+
+static void nameFromSeed(const EnglishWordGenerator &gen, KeyedSeed &seed, char *buffer) {
+	// rejected candidates just move on along the key's stream
+	while (!gen.generate(buffer, seed))
+		;
+}
+
+static void nameFromSeed(const EnglishWordGenerator &gen, const PositionalTables &tables, KeyedSeed &seed, char *buffer) {
+	while (!gen.generate(buffer, seed, tables))
+		;
+}
+
+void nameFor(uint64 galaxySeed, uint64 entityId, char *buffer) {
+	KeyedSeed seed(entityKey(galaxySeed, entityId));
+	nameFromSeed(sharedGenerator(), seed, buffer);
+}
+
+NameCode codeFor(uint64 galaxySeed, uint64 entityId) {
+	const EnglishWordGenerator &gen = sharedGenerator();
+	KeyedSeed seed(entityKey(galaxySeed, entityId));
+	Syllable syl[MAX_SYLLABLES];
+
+	// rejects the same candidates as nameFromSeed() does
+	int n;
+	while ((n = gen.generate(syl, seed)) == 0)
+		;
+	return en_nameCodec().encode(syl, n);
+}
+
+void nameFor(uint64 galaxySeed, uint64 entityId, const double *weights, char *buffer) {
+	KeyedSeed seed(entityKey(galaxySeed, entityId));
+	nameFromSeed(sharedGenerator(), mixedTables(weights), seed, buffer);
+}
+
+int familyFor(uint64 galaxySeed, uint64 systemId, int numMembers, char *names) {
+	static const FamilyGenerator families(sharedGenerator());
+
+	KeyedSeed seed(entityKey(galaxySeed, systemId));
+	return families.generate(names, numMembers, seed);
+}
+
+// the keys of n entities and the first NAME_PREFETCH_DRAWS draws of each;
+// independent hash chains, which overlap in the pipeline
+static void hashBlockScalar(uint64 galaxySeed, const uint64 *entityIds, int n, uint64 *keys, uint64 (*draws)[NAME_BLOCK]) {
+	int i, j;
+	for (i = 0; i < n; i++)
+		keys[i] = mix64(galaxySeed ^ mix64(entityIds[i] + KEYED_SEED_STEP));
+
+	for (j = 0; j < NAME_PREFETCH_DRAWS; j++)
+		for (i = 0; i < n; i++)
+			draws[j][i] = KeyedSeed::draw(keys[i], j + 1);
+}
+
+#ifdef NAMES_HAVE_AVX2
+
+// low 64 bits of the products, from 32 bit partial products
+__attribute__((target("avx2")))
+static inline __m256i mul64(__m256i a, __m256i b) {
+	__m256i low = _mm256_mul_epu32(a, b);
+	__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+	return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+// mix64() of four lanes
+__attribute__((target("avx2")))
+static inline __m256i mix64x4(__m256i z) {
+	const __m256i c1 = _mm256_set1_epi64x((long long)0xBF58476D1CE4E5B9ULL);
+	const __m256i c2 = _mm256_set1_epi64x((long long)0x94D049BB133111EBULL);
+
+	z = mul64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), c1);
+	z = mul64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), c2);
+	return _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+}
+
+__attribute__((target("avx2")))
+static void hashBlockAvx2(uint64 galaxySeed, const uint64 *entityIds, int n, uint64 *keys, uint64 (*draws)[NAME_BLOCK]) {
+	if (n < NAME_BLOCK) {
+		hashBlockScalar(galaxySeed, entityIds, n, keys, draws);
+		return;
+	}
+
+	// all lanes of a stage at once, so that the chains overlap
+	const __m256i step = _mm256_set1_epi64x((long long)KEYED_SEED_STEP);
+	const __m256i seed = _mm256_set1_epi64x((long long)galaxySeed);
+	__m256i key[NAME_BLOCK / 4];
+	int i, j;
+
+	for (i = 0; i < NAME_BLOCK / 4; i++)
+		key[i] = mix64x4(_mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(entityIds + 4 * i)), step));
+	for (i = 0; i < NAME_BLOCK / 4; i++) {
+		key[i] = mix64x4(_mm256_xor_si256(seed, key[i]));
+		_mm256_storeu_si256((__m256i *)(keys + 4 * i), key[i]);
+	}
+
+	for (j = 0; j < NAME_PREFETCH_DRAWS; j++) {
+		for (i = 0; i < NAME_BLOCK / 4; i++) {
+			key[i] = _mm256_add_epi64(key[i], step);
+			_mm256_storeu_si256((__m256i *)(draws[j] + 4 * i), mix64x4(key[i]));
+		}
+	}
+}
+
+#endif
+
+void namesFor(uint64 galaxySeed, const uint64 *entityIds, int count, char *names) {
+	const EnglishWordGenerator &gen = sharedGenerator();
+
+	uint64 keys[NAME_BLOCK];
+	uint64 draws[NAME_PREFETCH_DRAWS][NAME_BLOCK];
+	uint64 prefetched[NAME_PREFETCH_DRAWS];
+
+#ifdef NAMES_HAVE_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	for (int base = 0; base < count; base += NAME_BLOCK) {
+		int n = count - base < NAME_BLOCK ? count - base : NAME_BLOCK;
+		int i, j;
+
+#ifdef NAMES_HAVE_AVX2
+		if (avx2)
+			hashBlockAvx2(galaxySeed, entityIds + base, n, keys, draws);
+		else
+#endif
+			hashBlockScalar(galaxySeed, entityIds + base, n, keys, draws);
+
+		for (i = 0; i < n; i++) {
+			// the names must be those of nameFor()
+			assert(keys[i] == entityKey(galaxySeed, entityIds[base + i]));
+			assert(draws[NAME_PREFETCH_DRAWS - 1][i] == KeyedSeed::draw(keys[i], NAME_PREFETCH_DRAWS));
+
+			for (j = 0; j < NAME_PREFETCH_DRAWS; j++)
+				prefetched[j] = draws[j][i];
+
+			KeyedSeed seed(keys[i], prefetched, NAME_PREFETCH_DRAWS);
+			nameFromSeed(gen, seed, names + (size_t)(base + i) * MAX_NAME_LEN);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef __ENTITYNAMES__
+#define __ENTITYNAMES__
+
+#include "misc.h"
+#include "word.h"
+#include "namecode.h"
+
+// Stateless naming: the name of an entity is a pure function of the galaxy
+// seed and the entity id, all randomness coming from a KeyedSeed. Nothing
+// shared is written, so any thread or cluster node computes the same name
+// without storing or exchanging it.
+
+uint64 entityKey(uint64 galaxySeed, uint64 entityId);
+
+// renders into buffer, which must hold MAX_NAME_LEN chars
+void nameFor(uint64 galaxySeed, uint64 entityId, char *buffer);
+
+// the same name as a NameCode, for storing and sending entity names as 8
+// bytes; en_nameCodec().render() spells it like nameFor()
+NameCode codeFor(uint64 galaxySeed, uint64 entityId);
+
+// same for an entity in a region mixing phonologies, weights as for
+// mixedTables(); the mixture is looked up, not rebuilt, after its first use
+void nameFor(uint64 galaxySeed, uint64 entityId, const double *weights, char *buffer);
+
+// names sharing a root for numMembers entities of a system, the planets of
+// a star, into names[i * MAX_NAME_LEN]; returns how many there are, fewer
+// than numMembers only for families too large for a root, see
+// FamilyGenerator
+int familyFor(uint64 galaxySeed, uint64 systemId, int numMembers, char *names);
+
+// bulk variant, writing names[i * MAX_NAME_LEN] for entityIds[i]; the key
+// derivation and the first draws of each name are hashed a block of names
+// at a time, four lanes at once where there is AVX2; results are identical
+// to nameFor()
+void namesFor(uint64 galaxySeed, const uint64 *entityIds, int count, char *names);
+
+#endif
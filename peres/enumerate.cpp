@@ -0,0 +1,490 @@
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "enumerate.h"
+#include "generator.h"
+
+WordEnumerator::WordEnumerator(const Phonotactics &rules) : _rules(rules), _orthography(0), _blocklist(0) {
+	SegmentDistribution onsets, nuclei, codas;
+	en_setupOnsets(onsets);
+	en_setupNuclei(nuclei);
+	en_setupCodas(codas);
+
+	std::set<uint64> seenOpen, seenClosed;
+	Syllable s;
+
+	for (int o = 0; o < onsets.size(); o++) {
+		s.onset = onsets.item(o);
+		for (int n = 0; n < nuclei.size(); n++) {
+			s.nucleus = nuclei.item(n);
+			s.coda = Segment();
+			addSyllables(rules, s, _open, seenOpen);
+
+			for (int c = 0; c < codas.size(); c++) {
+				s.coda = codas.item(c);
+				addSyllables(rules, s, _closed, seenClosed);
+			}
+		}
+	}
+}
+
+void WordEnumerator::addSyllables(const Phonotactics &rules, const Syllable &s, std::vector<Unit> &units, std::set<uint64> &seen) {
+	if (!rules.acceptsSyllable(s))
+		return;
+
+	uint64 key = ((uint64)(s.hasOnset() ? s.onset._id + 1 : 0) << 40) |
+		((uint64)s.nucleus._id << 20) | (uint64)(s.hasCoda() ? s.coda._id + 1 : 0);
+	if (!seen.insert(key).second)
+		return;
+
+	Unit unit;
+	unit.numSegs = 0;
+	if (s.hasOnset()) {
+		unit.ids[unit.numSegs] = s.onset._id;
+		unit.slots[unit.numSegs++] = kSlotOnset;
+	}
+	unit.ids[unit.numSegs] = s.nucleus._id;
+	unit.slots[unit.numSegs++] = kSlotNucleus;
+	if (s.hasCoda()) {
+		unit.ids[unit.numSegs] = s.coda._id;
+		unit.slots[unit.numSegs++] = kSlotCoda;
+	}
+
+	unit.length = 0;
+	for (int i = 0; i < unit.numSegs; i++) {
+		const char *spelling = rules.segment(unit.ids[i])._spelling;
+		int length = (int)strlen(spelling);
+		memcpy(unit.text + unit.length, spelling, length);
+		unit.length += length;
+	}
+	unit.text[unit.length] = '\0';
+
+	units.push_back(unit);
+}
+
+void WordEnumerator::start(Path &path) const {
+	const uint64 *bias = _rules.countBias();
+
+	path.state = _rules.startState();
+	path.prev = -1;
+	path.counts[0] = bias[0];
+	path.counts[1] = bias[1];
+	path.counts[2] = bias[2];
+	path.length = 0;
+}
+
+// the checks of Phonotactics::accepts, one syllable at a time
+bool WordEnumerator::advance(Path &path, const Unit &unit) const {
+	const int *content = _rules.contentClasses();
+	const uint64 *increments = _rules.countIncrements();
+
+	for (int i = 0; i < unit.numSegs; i++) {
+		int id = unit.ids[i];
+
+		path.state = _rules.step(path.state, unit.slots[i], id);
+		if (path.state == Phonotactics::kDeadState)
+			return false;
+
+		if (_rules.noRepeat() && content[id] == path.prev)
+			return false;
+		path.prev = content[id];
+
+		const uint64 *inc = &increments[id * 3];
+		uint64 c0 = path.counts[0] + inc[0];
+		uint64 c1 = path.counts[1] + inc[1];
+		uint64 c2 = path.counts[2] + inc[2];
+		if ((c0 | c1 | c2) & 0x8888888888888888ULL)
+			return false;
+		path.counts[0] = c0;
+		path.counts[1] = c1;
+		path.counts[2] = c2;
+	}
+
+	if (path.length + unit.length >= MAX_NAME_LEN)
+		return false;
+	memcpy(path.text + path.length, unit.text, unit.length);
+	path.length += unit.length;
+	path.text[path.length] = '\0';
+	return true;
+}
+
+namespace {
+
+// a range of syllable indices at one level below a fixed prefix
+struct Task {
+	int						level;
+	int						lo;
+	int						hi;
+	int						prefix[MAX_SYLLABLES];
+	WordEnumerator::Path	path;
+};
+
+// output of one leaf range, in the order of its key
+struct Chunk {
+	int		key[MAX_SYLLABLES + 1];
+	int		worker;
+	size_t	begin;
+	size_t	end;
+
+	bool operator<(const Chunk &other) const {
+		return std::lexicographical_compare(key, key + MAX_SYLLABLES + 1, other.key, other.key + MAX_SYLLABLES + 1);
+	}
+};
+
+struct alignas(64) Worker {
+	std::mutex			lock;
+	std::deque<Task>	tasks;
+	std::vector<char>	buffer;
+	std::vector<Chunk>	chunks;
+	uint64				words;
+	uint64				pushed;
+	uint64				steals;
+	uint32				victim;
+
+	Worker() : words(0), pushed(0), steals(0), victim(0) {
+	}
+};
+
+class Scheduler {
+	const WordEnumerator		&_enumerator;
+	int							_last;
+	bool						_ordered;
+	FILE						*_out;
+	std::mutex					_outLock;
+	std::vector<Worker *>		_workers;
+	std::atomic<long long>		_pending;
+
+	// ordered output walks the prefixes of all but the last syllable
+	std::vector<int>					_index;		// [level] of the current prefix
+	std::vector<WordEnumerator::Path>	_paths;		// [level] before that level
+	bool								_started;
+
+	void push(Worker &worker, const Task &task) {
+		_pending.fetch_add(1);
+		std::lock_guard<std::mutex> guard(worker.lock);
+		worker.tasks.push_back(task);
+		worker.pushed++;
+	}
+
+	bool pop(Worker &worker, Task &task) {
+		std::lock_guard<std::mutex> guard(worker.lock);
+		if (worker.tasks.empty())
+			return false;
+		task = worker.tasks.back();
+		worker.tasks.pop_back();
+		return true;
+	}
+
+	bool steal(Worker &thief, Task &task) {
+		int n = (int)_workers.size();
+		for (int k = 0; k < n; k++) {
+			Worker &victim = *_workers[(thief.victim + k) % n];
+			if (&victim == &thief)
+				continue;
+
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.tasks.empty()) {
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				thief.victim += k;
+				thief.steals++;
+				return true;
+			}
+		}
+		thief.victim++;
+		return false;
+	}
+
+	bool idle(Worker &worker) {
+		std::lock_guard<std::mutex> guard(worker.lock);
+		return worker.tasks.empty();
+	}
+
+	void flush(Worker &worker) {
+		if (_out && !worker.buffer.empty()) {
+			std::lock_guard<std::mutex> guard(_outLock);
+			fwrite(&worker.buffer[0], 1, worker.buffer.size(), _out);
+		}
+		worker.buffer.clear();
+	}
+
+	void emit(Worker &worker, const Task &task, const WordEnumerator::Path &path) {
+		const Blocklist *blocklist = _enumerator.blocklist();
+		const Orthography *orthography = _enumerator.orthography();
+		if (!orthography) {
+			if (blocklist && blocklist->contains(path.text))
+				return;
+			worker.words++;
+			if (_out) {
+				worker.buffer.insert(worker.buffer.end(), path.text, path.text + path.length);
+				worker.buffer.push_back('\n');
+			}
+			return;
+		}
+		if (!_out && !blocklist) {
+			worker.words++;
+			return;
+		}
+
+		int ids[MAX_SEGS];
+		unsigned char slots[MAX_SEGS];
+		int numSegs = 0;
+		for (int level = 0; level <= _last; level++) {
+			const WordEnumerator::Unit &unit = _enumerator.unit(level, _last, task.prefix[level]);
+			for (int i = 0; i < unit.numSegs; i++) {
+				ids[numSegs] = unit.ids[i];
+				slots[numSegs++] = unit.slots[i];
+			}
+		}
+
+		char name[MAX_NAME_LEN * 4];
+		int length = orthography->render(ids, slots, numSegs, name);
+		if (blocklist && blocklist->contains(name))
+			return;
+		worker.words++;
+		if (!_out)
+			return;
+		name[length++] = '\n';
+		worker.buffer.insert(worker.buffer.end(), name, name + length);
+	}
+
+	void execute(Worker &worker, Task &task) {
+		int grain = task.level == _last ? ENUMERATE_LEAF_GRAIN : 1;
+
+		// hand out the upper half while nobody has anything to steal from us
+		while (task.hi - task.lo > grain && idle(worker)) {
+			Task upper = task;
+			upper.lo = task.lo + (task.hi - task.lo) / 2;
+			task.hi = upper.lo;
+			push(worker, upper);
+		}
+
+		Chunk chunk;
+		if (task.level == _last && _ordered) {
+			memset(chunk.key, 0, sizeof(chunk.key));
+			memcpy(chunk.key, task.prefix, task.level * sizeof(int));
+			chunk.key[task.level] = task.lo;
+			chunk.begin = worker.buffer.size();
+		}
+
+		for (int i = task.lo; i < task.hi; i++) {
+			const WordEnumerator::Unit &unit = _enumerator.unit(task.level, _last, i);
+			Task child;
+			child.path = task.path;
+			if (!_enumerator.advance(child.path, unit))
+				continue;
+
+			memcpy(child.prefix, task.prefix, task.level * sizeof(int));
+			child.prefix[task.level] = i;
+
+			if (task.level == _last) {
+				emit(worker, child, child.path);
+			} else {
+				child.level = task.level + 1;
+				child.lo = 0;
+				child.hi = child.level == _last ? _enumerator.numClosed() : _enumerator.numOpen();
+				execute(worker, child);
+			}
+		}
+
+		if (task.level == _last) {
+			if (_ordered) {
+				chunk.worker = (int)(&worker - _workers[0]);
+				chunk.end = worker.buffer.size();
+				if (chunk.end > chunk.begin)
+					worker.chunks.push_back(chunk);
+			} else if (worker.buffer.size() >= ENUMERATE_FLUSH_SIZE) {
+				flush(worker);
+			}
+		}
+	}
+
+public:
+	Scheduler(const WordEnumerator &enumerator, int last, bool ordered, FILE *out) :
+		_enumerator(enumerator), _last(last), _ordered(ordered), _out(out), _pending(0), _started(false) {
+	}
+
+	void work(Worker &worker) {
+		Task task;
+		for (;;) {
+			if (pop(worker, task) || steal(worker, task)) {
+				execute(worker, task);
+				_pending.fetch_sub(1);
+			} else if (_pending.load() == 0) {
+				break;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool nextPrefix();
+	void runTasks(const std::vector<Task> &tasks, int numThreads);
+	size_t writeChunks();
+
+	uint64 run(int numThreads, EnumerationStats *stats);
+};
+
+}
+
+// moves to the next prefix of _last - 1 syllables that passes the rules,
+// false after the last one
+bool Scheduler::nextPrefix() {
+	int depth = _last - 1;
+	int level = depth - 1;
+	if (!_started) {
+		_started = true;
+		_enumerator.start(_paths[0]);
+		if (depth == 0)
+			return true;
+		level = 0;
+		_index[0] = -1;
+	}
+
+	while (level >= 0) {
+		if (++_index[level] >= _enumerator.numOpen()) {
+			level--;
+			continue;
+		}
+		_paths[level + 1] = _paths[level];
+		if (!_enumerator.advance(_paths[level + 1], _enumerator.unit(level, _last, _index[level])))
+			continue;
+		if (++level == depth)
+			return true;
+		_index[level] = -1;
+	}
+	return false;
+}
+
+void Scheduler::runTasks(const std::vector<Task> &tasks, int numThreads) {
+	for (size_t i = 0; i < tasks.size(); i++)
+		push(*_workers[0], tasks[i]);
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.push_back(std::thread(&Scheduler::work, this, std::ref(*_workers[i])));
+	work(*_workers[0]);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+// writes the chunks held back in sequential order, returns their size
+size_t Scheduler::writeChunks() {
+	std::vector<Chunk> chunks;
+	size_t bytes = 0;
+	for (size_t i = 0; i < _workers.size(); i++) {
+		chunks.insert(chunks.end(), _workers[i]->chunks.begin(), _workers[i]->chunks.end());
+		bytes += _workers[i]->buffer.size();
+	}
+
+	std::sort(chunks.begin(), chunks.end());
+	for (size_t i = 0; i < chunks.size(); i++)
+		fwrite(&_workers[chunks[i].worker]->buffer[chunks[i].begin], 1, chunks[i].end - chunks[i].begin, _out);
+
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i]->buffer.clear();
+		_workers[i]->chunks.clear();
+	}
+	return bytes;
+}
+
+uint64 Scheduler::run(int numThreads, EnumerationStats *stats) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	std::vector<Worker> workers(numThreads);
+	for (int i = 0; i < numThreads; i++)
+		_workers.push_back(&workers[i]);
+
+	std::vector<Task> tasks(1);
+	Task &root = tasks[0];
+	root.level = 0;
+	root.lo = 0;
+	root.hi = _last == 0 ? _enumerator.numClosed() : _enumerator.numOpen();
+	_enumerator.start(root.path);
+
+	if (!_ordered || !_out) {
+		runTasks(tasks, numThreads);
+		for (int i = 0; i < numThreads; i++)
+			flush(workers[i]);
+	} else if (_last == 0) {
+		runTasks(tasks, numThreads);
+		writeChunks();
+	} else {
+		// a window is a run of consecutive prefixes of all but the last
+		// syllable, as many as fit ENUMERATE_WINDOW_SIZE going by the last
+		int depth = _last - 1;
+		int numOpen = _enumerator.numOpen();
+		_index.resize(depth > 0 ? depth : 1);
+		_paths.resize(depth + 1);
+
+		bool more = nextPrefix();
+		int next = 0;
+		int width = 1;
+		uint64 written = 0;
+		while (more) {
+			tasks.clear();
+			for (int taken = 0; more && taken < width; ) {
+				Task task;
+				task.level = depth;
+				task.path = _paths[depth];
+				memcpy(task.prefix, &_index[0], depth * sizeof(int));
+				task.lo = next;
+				task.hi = numOpen - next < width - taken ? numOpen : next + (width - taken);
+				tasks.push_back(task);
+
+				taken += task.hi - task.lo;
+				next = task.hi;
+				if (next == numOpen) {
+					more = nextPrefix();
+					next = 0;
+				}
+			}
+
+			runTasks(tasks, numThreads);
+			// the next one aims at ENUMERATE_WINDOW_SIZE, growing at most
+			// twofold, and stays below it even if every last syllable passes
+			size_t bytes = writeChunks();
+			written += bytes;
+			uint64 words = 0;
+			for (int i = 0; i < numThreads; i++)
+				words += workers[i].words;
+			double wordSize = words > 0 ? (double)written / words : MAX_NAME_LEN;
+			double most = ENUMERATE_WINDOW_SIZE / (wordSize * _enumerator.numClosed());
+			double scale = bytes > 0 ? (double)ENUMERATE_WINDOW_SIZE / bytes : 2.0;
+			width = (int)std::max(1.0, std::min(width * std::min(scale, 2.0), most));
+		}
+	}
+
+	uint64 words = 0;
+	EnumerationStats total = { 0, 0, 0, 0 };
+	for (int i = 0; i < numThreads; i++) {
+		words += workers[i].words;
+		total.tasks += workers[i].pushed;
+		total.steals += workers[i].steals;
+	}
+
+	if (stats) {
+		*stats = total;
+		stats->words = words;
+		stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	return words;
+}
+
+uint64 WordEnumerator::run(int numSyllables, int numThreads, bool ordered, FILE *out, EnumerationStats *stats) const {
+	if (numSyllables < 1 || numSyllables > MAX_SYLLABLES)
+		return 0;
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	Scheduler scheduler(*this, numSyllables - 1, ordered, out);
+	return scheduler.run(numThreads, stats);
+}
@@ -0,0 +1,120 @@
+#ifndef __ENUMERATE__
+#define __ENUMERATE__
+
+#include <stdio.h>
+
+#include <set>
+#include <vector>
+
+#include "misc.h"
+#include "blocklist.h"
+#include "word.h"
+
+// last level ranges are split down to this many syllables
+#define ENUMERATE_LEAF_GRAIN	256
+
+// per thread output is flushed once it grows past this, unless ordered
+#define ENUMERATE_FLUSH_SIZE	(1 << 20)
+
+// ordered output is held back for about this many bytes at a time
+#define ENUMERATE_WINDOW_SIZE	(16 << 20)
+
+struct EnumerationStats {
+	uint64	words;			// valid words written
+	uint64	tasks;			// ranges handed to the scheduler
+	uint64	steals;			// of those, taken by another thread
+	double	seconds;
+};
+
+// Lists every valid word of a given number of syllables.
+//
+// A word is a choice of one valid open syllable per level and a closed one
+// for the last, so the space is a tree of syllable indices. The walk keeps
+// the DFA state, the previous segment and the maxcount counters per level
+// and drops a subtree as soon as the prefix is rejected; those checks only
+// ever go from passing to failing, so this is exact.
+//
+// Valid subtrees differ wildly in size, so the tree is cut into ranges of
+// syllable indices on a work-stealing scheduler: every thread runs ranges
+// from the bottom of its own deque and splits off the upper half of a
+// range while its deque is empty, idle threads steal from the top of
+// others. Names go to per-thread buffers; for ordered output each finished
+// leaf range is a chunk keyed by its prefix. The prefixes of all but the
+// last syllable are then taken a window of consecutive ones at a time,
+// and the chunks of a window are sorted into the sequential order and
+// written before the next one starts. The window grows or shrinks to hold
+// about ENUMERATE_WINDOW_SIZE bytes of names, so ordering costs that much
+// memory instead of the whole listing.
+class WordEnumerator {
+
+public:
+	struct Unit {
+		int				numSegs;
+		int				ids[3];
+		unsigned char	slots[3];
+		char			text[MAX_NAME_LEN];
+		int				length;
+	};
+
+	// a word prefix that passed the rules so far
+	struct Path {
+		int				state;
+		int				prev;
+		uint64			counts[3];
+		int				length;
+		char			text[MAX_NAME_LEN];
+	};
+
+private:
+	const Phonotactics		&_rules;
+	const Orthography		*_orthography;
+	const Blocklist			*_blocklist;
+	std::vector<Unit>		_open;
+	std::vector<Unit>		_closed;
+
+	static void addSyllables(const Phonotactics &rules, const Syllable &s, std::vector<Unit> &units, std::set<uint64> &seen);
+
+public:
+	WordEnumerator(const Phonotactics &rules);
+
+	// renders with the orthography instead of the segment table, 0 for none
+	void setOrthography(const Orthography *orthography) {
+		_orthography = orthography;
+	}
+
+	const Orthography *orthography() const {
+		return _orthography;
+	}
+
+	// leaves out words whose rendering contains a blocked substring, 0 for
+	// none
+	void setBlocklist(const Blocklist *blocklist) {
+		_blocklist = blocklist;
+	}
+
+	const Blocklist *blocklist() const {
+		return _blocklist;
+	}
+
+	int numOpen() const {
+		return (int)_open.size();
+	}
+
+	int numClosed() const {
+		return (int)_closed.size();
+	}
+
+	const Unit &unit(int level, int last, int index) const {
+		return level == last ? _closed[index] : _open[index];
+	}
+
+	// appends a syllable to path, false if the word can no longer pass
+	bool advance(Path &path, const Unit &unit) const;
+	void start(Path &path) const;
+
+	// writes every valid, unblocked word of numSyllables syllables to out,
+	// one per line, or only counts them for out 0; numThreads 0 uses every core
+	uint64 run(int numSyllables, int numThreads, bool ordered, FILE *out, EnumerationStats *stats = 0) const;
+};
+
+#endif
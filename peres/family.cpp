@@ -0,0 +1,152 @@
+#include <string.h>
+
+#include <unordered_set>
+
+#include "family.h"
+
+FamilyGenerator::FamilyGenerator(const EnglishWordGenerator &gen) : _gen(gen) {
+}
+
+// appends the table spellings of word at buffer + length, continuing the
+// blocklist scan; false if that completes a blocked entry
+bool FamilyGenerator::spell(const Word &word, char *buffer, int &length, uint32 &blockState) const {
+	const Blocklist *blocklist = _gen.blocklist();
+	char *dst = buffer + length;
+
+	for (int i = 0; i < word.numSegments(); i++) {
+		const char *spelling = word.segment(i)._spelling;
+		if (blocklist && !blocklist->feed(blockState, spelling))
+			return false;
+
+		int len = (int)strlen(spelling);
+		memcpy(dst, spelling, len);
+		dst += len;
+	}
+
+	*dst = '\0';
+	length = (int)(dst - buffer);
+	return true;
+}
+
+// draws the syllable count and all syllables but the last until they pass
+// the rules and the blocklist; false if none did in FAMILY_MAX_ROOT_DRAWS
+bool FamilyGenerator::drawRoot(Syllable *syl, Root &root, Seed &seed, const PositionalTables &tables, int &rejected) const {
+	const CountDistribution &counts = _gen.syllableCounts();
+	const Blocklist *blocklist = _gen.blocklist();
+	const Phonotactics &rules = tables.rules();
+
+	for (int draws = 0; draws < FAMILY_MAX_ROOT_DRAWS; draws++) {
+		seed.beginSample();
+
+		int n = counts.item(0);
+		if (counts.size() > 1)
+			n = counts.getItem(seed.getBits(counts.cumFreq()));
+
+		for (int i = 0; i < n - 1; i++)
+			_gen.openGenerator().genSyllable(syl[i], seed, syllablePosition(i, n), tables);
+
+		Word word(syl, n - 1);
+		root.walk = rules.startWalk();
+		root.length = 0;
+		root.blockState = blocklist ? blocklist->start() : 0;
+		root.numSyllables = n;
+
+		if (word.validate(rules, root.walk) && (_gen.orthography() || spell(word, root.text, root.length, root.blockState)))
+			return true;
+		rejected++;
+	}
+	return false;
+}
+
+static bool repeats(const char *names, int count, const char *name) {
+	for (int i = 0; i < count; i++)
+		if (!strcmp(names + (size_t)i * MAX_NAME_LEN, name))
+			return true;
+	return false;
+}
+
+// no root has more different completions than closing syllables
+static double maxCompletions(const PositionalTables &tables) {
+	double most = 0;
+	for (int position = 0; position < kNumPositions; position++) {
+		if (!isClosedPosition(position))
+			continue;
+		double count = 1;
+		for (int slot = 0; slot < kNumSlots; slot++)
+			count *= tables.table(position, slot).distribution().size();
+		most = count > most ? count : most;
+	}
+	return most;
+}
+
+int FamilyGenerator::generate(char *names, int numSiblings, Seed &seed, int *rejected) const {
+	return generate(names, numSiblings, seed, _gen.tables(), rejected);
+}
+
+int FamilyGenerator::generate(char *names, int numSiblings, Seed &seed, const PositionalTables &tables, int *rejected) const {
+	if (numSiblings > maxCompletions(tables))
+		return 0;
+
+	int numRejected = 0;
+	int k = 0;
+	// large families look repeats up by FNV-1a, a collision only costs a
+	// name that would have been new
+	bool hashed = numSiblings > FAMILY_LINEAR_REPEATS;
+	std::unordered_set<uint64> seen;
+
+	for (int roots = 0; roots < FAMILY_MAX_ROOTS; roots++) {
+		Syllable syl[MAX_SYLLABLES];
+		Root root;
+		if (!drawRoot(syl, root, seed, tables, numRejected)) {
+			k = 0;
+			break;
+		}
+		seen.clear();
+
+		int n = root.numSyllables;
+		int last = n - 1;
+		int position = syllablePosition(last, n);
+
+		for (k = 0; k < numSiblings; k++) {
+			char *name = names + (size_t)k * MAX_NAME_LEN;
+
+			int attempts;
+			for (attempts = 0; attempts < FAMILY_MAX_ATTEMPTS; attempts++) {
+				_gen.closedGenerator().genSyllable(syl[last], seed, position, tables);
+
+				Word completion(syl + last, 1);
+				Phonotactics::Walk walk = root.walk;
+				if (!completion.validate(tables.rules(), walk)) {
+					numRejected++;
+					continue;
+				}
+
+				bool spelled;
+				if (_gen.orthography()) {
+					spelled = _gen.render(Word(syl, n), name);
+				} else {
+					int length = root.length;
+					uint32 blockState = root.blockState;
+					memcpy(name, root.text, root.length);
+					spelled = spell(completion, name, length, blockState);
+				}
+
+				if (spelled) {
+					bool repeat = hashed ? !seen.insert(fnv1a(name)).second : repeats(names, k, name);
+					if (!repeat)
+						break;
+				}
+				numRejected++;
+			}
+			if (attempts == FAMILY_MAX_ATTEMPTS)
+				break;
+		}
+
+		if (k == numSiblings)
+			break;
+	}
+
+	if (rejected)
+		*rejected += numRejected;
+	return k;
+}
@@ -0,0 +1,65 @@
+#ifndef __FAMILY__
+#define __FAMILY__
+
+#include "misc.h"
+#include "generator.h"
+
+// completions drawn for one sibling before the root is given up on
+#define FAMILY_MAX_ATTEMPTS		256
+
+// roots drawn for one family before it is returned short
+#define FAMILY_MAX_ROOTS		16
+
+// root draws failing the rules or the blocklist before a family gives up
+#define FAMILY_MAX_ROOT_DRAWS	(FAMILY_MAX_ROOTS * FAMILY_MAX_ATTEMPTS)
+
+// larger families find repeats by hash instead of comparing all names
+#define FAMILY_LINEAR_REPEATS	32
+
+// Names for a group of related entities, the planets of a star, sharing a
+// root: all but the last syllable are drawn once, and each sibling only
+// draws its closing syllable.
+//
+// The root is validated on its own into a Phonotactics::Walk, which every
+// completion continues from, so a sibling costs the rules over one
+// syllable; a root no word could start with is redrawn before any
+// completion is tried, up to FAMILY_MAX_ROOT_DRAWS times. The root is spelled and scanned for blocked text
+// once too, unless an orthography spells it by its neighbours, in which
+// case siblings are rendered whole. Repeats within the family are drawn
+// again, and if a root turns out to have too few valid completions the
+// whole family is drawn again, up to FAMILY_MAX_ROOTS times; a family
+// larger than any root can complete comes back short, one larger than the
+// closing syllables empty without drawing.
+//
+// The syllable count of the family is drawn like that of a single name,
+// from the generator's distribution, which also brings its blocklist,
+// orthography and tables. One syllable families have an empty root.
+class FamilyGenerator {
+
+	// the shared part of a family, checked and spelled once
+	struct Root {
+		Phonotactics::Walk	walk;
+		char				text[MAX_NAME_LEN];
+		int					length;
+		uint32				blockState;		// the blocklist scan after text
+		int					numSyllables;	// of the family's names
+	};
+
+	const EnglishWordGenerator	&_gen;
+
+	bool spell(const Word &word, char *buffer, int &length, uint32 &blockState) const;
+	bool drawRoot(Syllable *syl, Root &root, Seed &seed, const PositionalTables &tables, int &rejected) const;
+
+public:
+	// gen must outlive the family generator
+	FamilyGenerator(const EnglishWordGenerator &gen);
+
+	// numSiblings distinct valid names into names[i * MAX_NAME_LEN], the
+	// generator's tables or the given ones; returns the number of names,
+	// fewer if the last root drawn had no more completions and 0 if no root
+	// can have that many or none passed, and adds the rejected draws to rejected
+	int generate(char *names, int numSiblings, Seed &seed, int *rejected = 0) const;
+	int generate(char *names, int numSiblings, Seed &seed, const PositionalTables &tables, int *rejected = 0) const;
+};
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef __GENERATOR__
+#define __GENERATOR__
+
+#include <vector>
+#include "arena.h"
+#include "tactics.h"
+#include "en_phonology.h"
+#include "misc.h"
+#include "word.h"
+#include "positions.h"
+
+void en_setupOnsets(SegmentDistribution &dist);
+void en_setupNuclei(SegmentDistribution &dist);
+void en_setupCodas(SegmentDistribution &dist);
+
+
+
+class EnglishSyllableGenerator : public SeededGenerator {
+
+protected:
+	SegmentDistribution		codas;
+	SegmentDistribution		onsets;
+	SegmentDistribution		nuclei;
+	const PositionalTables	&positions;
+
+	// quasi-random draws keep their strata only through the cumulative lookup
+	static const Segment &draw(const AliasTable<Segment> &table, Seed &seed, bool ordered) {
+		if (ordered)
+			return table.getOrderedItem(seed.getBits(table.distribution().cumFreq()));
+		return table.getItem(seed.getBits(table.range()));
+	}
+
+public:
+	// the phonotactic rules restricted to one syllable; whatever fails here
+	// fails in every word too, so rejecting early leaves the word
+	// distribution as it is
+	static bool validateSyllable(const Syllable &syllable) {
+		return en_phonotactics().acceptsSyllable(syllable);
+	}
+
+	EnglishSyllableGenerator(Seed &seed) : SeededGenerator(seed), positions(en_positionalTables()) {
+		en_setupCodas(codas);
+		en_setupOnsets(onsets);
+		en_setupNuclei(nuclei);
+	}
+
+	// draws from the given seed instead of the generator's own, so shared
+	// generators can serve concurrent callers
+	virtual void genSyllable(Syllable &s, Seed &seed) const = 0;
+
+	// same from the tables of a SyllablePosition, which leave out what the
+	// rules reject there
+	void genSyllable(Syllable &s, Seed &seed, int position) const {
+		genSyllable(s, seed, position, positions);
+	}
+
+	// same from other tables over the English inventory, such as a mixture,
+	// under the rules they were built for
+	virtual void genSyllable(Syllable &s, Seed &seed, int position, const PositionalTables &tables) const = 0;
+
+	void genSyllable(Syllable &s) {
+		genSyllable(s, _seed);
+	}
+
+};
+
+class EnglishOpenSyllableGenerator : public EnglishSyllableGenerator {
+public:
+	EnglishOpenSyllableGenerator(Seed &seed) : EnglishSyllableGenerator(seed) {
+	}
+	using EnglishSyllableGenerator::genSyllable;
+	virtual void genSyllable(Syllable& s, Seed &seed) const {
+		// callers reuse syllable arrays across words of different lengths
+		s.coda = Segment();
+		do {
+			s.onset = onsets.getItem(seed.getBits(onsets.cumFreq()));
+			s.nucleus = nuclei.getItem(seed.getBits(nuclei.cumFreq()));
+		} while (!validateSyllable(s));
+	}
+	virtual void genSyllable(Syllable& s, Seed &seed, int position, const PositionalTables &tables) const {
+		const AliasTable<Segment> &onsetTable = tables.table(position, kSlotOnset);
+		const AliasTable<Segment> &nucleusTable = tables.table(position, kSlotNucleus);
+		bool ordered = seed.quasiRandom();
+		s.coda = Segment();
+		do {
+			s.onset = draw(onsetTable, seed, ordered);
+			s.nucleus = draw(nucleusTable, seed, ordered);
+		} while (!tables.rules().acceptsSyllable(s));
+	}
+};
+
+class EnglishClosedSyllableGenerator : public EnglishSyllableGenerator {
+public:
+	EnglishClosedSyllableGenerator(Seed &seed) : EnglishSyllableGenerator(seed) {
+	}
+	using EnglishSyllableGenerator::genSyllable;
+	virtual void genSyllable(Syllable& s, Seed &seed) const {
+		do {
+			s.onset = onsets.getItem(seed.getBits(onsets.cumFreq()));
+			s.nucleus = nuclei.getItem(seed.getBits(nuclei.cumFreq()));
+			s.coda = codas.getItem(seed.getBits(codas.cumFreq()));
+		} while (!validateSyllable(s));
+
+		return;
+	}
+	virtual void genSyllable(Syllable& s, Seed &seed, int position, const PositionalTables &tables) const {
+		const AliasTable<Segment> &onsetTable = tables.table(position, kSlotOnset);
+		const AliasTable<Segment> &nucleusTable = tables.table(position, kSlotNucleus);
+		const AliasTable<Segment> &codaTable = tables.table(position, kSlotCoda);
+		bool ordered = seed.quasiRandom();
+		do {
+			s.onset = draw(onsetTable, seed, ordered);
+			s.nucleus = draw(nucleusTable, seed, ordered);
+			s.coda = draw(codaTable, seed, ordered);
+		} while (!tables.rules().acceptsSyllable(s));
+	}
+};
+
+// Draw probabilities of the syllables in each SyllablePosition, for the
+// English tables or any others over the English inventory. The English ones
+// are the same for every generator, so they are built once on first use.
+class EnglishSyllableOdds {
+
+	std::vector<double>	_prob[kNumPositions][kNumSlots];	// [position][slot][segment id]
+	double				_mass[kNumPositions];				// of the syllables passing validation
+
+	static void addDistribution(const SegmentDistribution &dist, std::vector<double> &prob) {
+		for (int i = 0; i < dist.size(); i++)
+			prob[dist.item(i)._id] += (double)dist.frequency(i) / dist.cumFreq();
+	}
+
+	double draw(const Syllable &s, int position) const {
+		const std::vector<double> *prob = _prob[position];
+		double p = prob[kSlotOnset][s.onset._id] * prob[kSlotNucleus][s.nucleus._id];
+		return isClosedPosition(position) ? p * prob[kSlotCoda][s.coda._id] : p;
+	}
+
+public:
+	// of syllables drawn from tables and passing their rules
+	explicit EnglishSyllableOdds(const PositionalTables &tables) {
+		for (int position = 0; position < kNumPositions; position++) {
+			bool closed = isClosedPosition(position);
+			for (int slot = 0; slot < kNumSlots; slot++) {
+				_prob[position][slot].assign(en_inventory().size, 0.0);
+				if (slot != kSlotCoda || closed)
+					addDistribution(tables.table(position, slot).distribution(), _prob[position][slot]);
+			}
+
+			const SegmentDistribution &onsets = tables.table(position, kSlotOnset).distribution();
+			const SegmentDistribution &nuclei = tables.table(position, kSlotNucleus).distribution();
+			const SegmentDistribution &codas = tables.table(position, kSlotCoda).distribution();
+
+			_mass[position] = 0;
+			Syllable s;
+			for (int o = 0; o < onsets.size(); o++) {
+				s.onset = onsets.item(o);
+				for (int n = 0; n < nuclei.size(); n++) {
+					s.nucleus = nuclei.item(n);
+					s.coda = Segment();
+					if (!closed) {
+						if (tables.rules().acceptsSyllable(s))
+							_mass[position] += draw(s, position);
+						continue;
+					}
+					for (int c = 0; c < codas.size(); c++) {
+						s.coda = codas.item(c);
+						if (tables.rules().acceptsSyllable(s))
+							_mass[position] += draw(s, position);
+					}
+				}
+			}
+		}
+	}
+
+	static const EnglishSyllableOdds &get() {
+		static const EnglishSyllableOdds odds(en_positionalTables());
+		return odds;
+	}
+
+	// chance the generator of the position returns s
+	double probability(const Syllable &s, int position) const {
+		return draw(s, position) / _mass[position];
+	}
+
+	// chance of segment id in a slot of the position before validation, and
+	// the mass of the syllables passing it; probability() is their ratio
+	double segmentProbability(int position, int slot, int id) const {
+		return _prob[position][slot][id];
+	}
+
+	double mass(int position) const {
+		return _mass[position];
+	}
+};
+
+// not Distribution<int>, whose two addItem() overloads would be ambiguous
+typedef Distribution<unsigned char> CountDistribution;
+
+// The open + closed pipeline, owning its generators so that every thread
+// can run a private copy. A word is a run of open syllables closed by a
+// closed one; the syllable count comes from a distribution which defaults
+// to always two.
+class EnglishWordGenerator {
+
+	EnglishOpenSyllableGenerator	_openGen;
+	EnglishClosedSyllableGenerator	_closedGen;
+	Seed							&_openSeed;
+	Seed							&_closedSeed;
+	CountDistribution				_syllableCounts;
+	const Blocklist					*_blocklist;
+	const Orthography				*_orthography;
+	const PositionalTables			*_tables;
+
+	// instantiated once per syllable count, so the loop is unrolled
+	template <int N>
+	void drawWord(Syllable *syl, Seed &openSeed, Seed &closedSeed, const PositionalTables &tables) const {
+		for (int i = 0; i < N - 1; i++)
+			_openGen.genSyllable(syl[i], openSeed, syllablePosition(i, N), tables);
+		_closedGen.genSyllable(syl[N - 1], closedSeed, syllablePosition(N - 1, N), tables);
+	}
+
+	// the open seed starts every word; hand the same SobolSeed in for both
+	// to stratify whole words
+	int drawSyllables(Syllable *syl, Seed &openSeed, Seed &closedSeed, const PositionalTables &tables) const {
+		openSeed.beginSample();
+
+		// a single entry distribution costs no draw, keeping old sequences
+		int n = _syllableCounts.item(0);
+		if (_syllableCounts.size() > 1)
+			n = _syllableCounts.getItem(openSeed.getBits(_syllableCounts.cumFreq()));
+
+		switch (n) {
+		case 1:		drawWord<1>(syl, openSeed, closedSeed, tables); return 1;
+		case 2:		drawWord<2>(syl, openSeed, closedSeed, tables); return 2;
+		case 3:		drawWord<3>(syl, openSeed, closedSeed, tables); return 3;
+		case 4:		drawWord<4>(syl, openSeed, closedSeed, tables); return 4;
+		default:	drawWord<MAX_SYLLABLES>(syl, openSeed, closedSeed, tables); return MAX_SYLLABLES;
+		}
+	}
+
+	bool generate(char *buffer, Seed &openSeed, Seed &closedSeed, const PositionalTables &tables) const {
+		Syllable syl[MAX_SYLLABLES];
+		Word word(syl, drawSyllables(syl, openSeed, closedSeed, tables));
+
+		return render(word, buffer) && word.validate(tables.rules());
+	}
+
+public:
+	EnglishWordGenerator(Seed &openSeed, Seed &closedSeed) :
+		_openGen(openSeed), _closedGen(closedSeed), _openSeed(openSeed), _closedSeed(closedSeed), _blocklist(0), _orthography(0),
+		_tables(&en_positionalTables()) {
+
+		_syllableCounts.addItem((unsigned char)2, 1);
+	}
+
+	// weights by syllable count, counts outside 1..MAX_SYLLABLES are dropped
+	void setSyllableCounts(const CountDistribution &counts) {
+		CountDistribution valid;
+		for (int i = 0; i < counts.size(); i++) {
+			int n = counts.item(i);
+			if (n >= 1 && n <= MAX_SYLLABLES)
+				valid.addItem((unsigned char)n, counts.frequency(i));
+		}
+		if (valid.size() > 0)
+			_syllableCounts = valid;
+	}
+
+	// candidates containing one of its entries are rejected, 0 for none;
+	// the blocklist must outlive the generator
+	void setBlocklist(const Blocklist *blocklist) {
+		_blocklist = blocklist;
+	}
+
+	const Blocklist *blocklist() const {
+		return _blocklist;
+	}
+
+	// spells the names by context instead of the segment table, 0 for the
+	// table; must outlive the generator like the blocklist
+	void setOrthography(const Orthography *orthography) {
+		_orthography = orthography;
+	}
+
+	const Orthography *orthography() const {
+		return _orthography;
+	}
+
+	// draws from other tables over the English inventory, such as a
+	// mixture, 0 for the English ones; must outlive the generator. Words are
+	// validated with the rules of the tables, the orthography still follows
+	// the English ones and probability() needs the odds of the tables.
+	void setTables(const PositionalTables *tables) {
+		_tables = tables ? tables : &en_positionalTables();
+	}
+
+	const CountDistribution &syllableCounts() const {
+		return _syllableCounts;
+	}
+
+	const PositionalTables &tables() const {
+		return *_tables;
+	}
+
+	const EnglishOpenSyllableGenerator &openGenerator() const {
+		return _openGen;
+	}
+
+	const EnglishClosedSyllableGenerator &closedGenerator() const {
+		return _closedGen;
+	}
+
+	// spells a word with the orthography if there is one, false if the
+	// blocklist rejects it
+	bool render(const Word &word, char *buffer) const {
+		if (_orthography) {
+			word.render(buffer, *_orthography);
+			return !_blocklist || !_blocklist->contains(buffer);
+		}
+		if (!_blocklist) {
+			word.render(buffer);
+			return true;
+		}
+		return word.render(buffer, *_blocklist);
+	}
+
+	// draws the syllables of a candidate without validating it, returns
+	// their count; syl must hold MAX_SYLLABLES
+	int drawSyllables(Syllable *syl) {
+		return drawSyllables(syl, _openSeed, _closedSeed, *_tables);
+	}
+
+	// renders a candidate into buffer, returns false if it was rejected
+	bool generate(char *buffer) {
+		return generate(buffer, _openSeed, _closedSeed, *_tables);
+	}
+
+	// same pipeline drawing everything from one caller owned seed
+	bool generate(char *buffer, Seed &seed) const {
+		return generate(buffer, seed, seed, *_tables);
+	}
+
+	// same from the given tables, so one shared generator serves regions
+	// with different mixtures
+	bool generate(char *buffer, Seed &seed, const PositionalTables &tables) const {
+		return generate(buffer, seed, seed, tables);
+	}
+
+	// same keeping the syllables of a candidate instead of its text, which
+	// is only rendered for the blocklist; returns their count, 0 if it was
+	// rejected. syl must hold MAX_SYLLABLES
+	int generate(Syllable *syl, Seed &seed) const {
+		int n = drawSyllables(syl, seed, seed, *_tables);
+		Word word(syl, n);
+
+		char buffer[MAX_NAME_LEN];
+		if (_blocklist && !render(word, buffer))
+			return 0;
+		return word.validate(_tables->rules()) ? n : 0;
+	}
+
+	// chance a candidate is drawn as these syllables from the English
+	// tables; divided by the acceptance NameAnalyzer reports it is the
+	// chance among valid words
+	double probability(const Syllable *syl, int numSyllables) const {
+		return probability(syl, numSyllables, EnglishSyllableOdds::get());
+	}
+
+	// same for the tables odds were built from, EnglishSyllableOdds(tables())
+	double probability(const Syllable *syl, int numSyllables, const EnglishSyllableOdds &odds) const {
+		double p = 1.0;
+		if (_syllableCounts.size() > 1) {
+			p = 0.0;
+			for (int i = 0; i < _syllableCounts.size(); i++)
+				if (_syllableCounts.item(i) == numSyllables)
+					p = (double)_syllableCounts.frequency(i) / _syllableCounts.cumFreq();
+		}
+
+		for (int i = 0; i < numSyllables; i++)
+			p *= odds.probability(syl[i], syllablePosition(i, numSyllables));
+		return p;
+	}
+
+	// keeps drawing until a candidate passes, returns the number of rejections
+	int generateValid(char *buffer) {
+		int rejected = 0;
+		while (!generate(buffer))
+			rejected++;
+		return rejected;
+	}
+
+	// same, rendering straight into arena
+	NameRef generateValid(NameArena &arena) {
+		char *buffer;
+		do
+			buffer = arena.reserve(MAX_NAME_LEN);
+		while (!generate(buffer));
+		return arena.commit((int)strlen(buffer));
+	}
+};
+
+#endif
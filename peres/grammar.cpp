@@ -0,0 +1,335 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <sstream>
+
+#include "grammar.h"
+#include "generator.h"
+
+static const EnglishWordGenerator &sharedNameGenerator() {
+	// only ever used through the const, seed taking entry points
+	static NullSeed nullSeed;
+	static const EnglishWordGenerator gen(nullSeed, nullSeed);
+	return gen;
+}
+
+static std::string trim(const std::string &text) {
+	size_t begin = 0, end = text.size();
+	while (begin < end && isspace((unsigned char)text[begin]))
+		begin++;
+	while (end > begin && isspace((unsigned char)text[end - 1]) && !(end - 1 > begin && text[end - 2] == '\\'))
+		end--;
+	return text.substr(begin, end - begin);
+}
+
+// splits on the '|' not escaped by '\', escapes are kept for the template parser
+static void splitAlternatives(const std::string &text, std::vector<std::string> &parts) {
+	parts.clear();
+	std::string part;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '\\' && i + 1 < text.size()) {
+			part += text[i];
+			part += text[++i];
+		} else if (text[i] == '|') {
+			parts.push_back(trim(part));
+			part.clear();
+		} else {
+			part += text[i];
+		}
+	}
+	parts.push_back(trim(part));
+}
+
+static char *append(char *out, char *limit, const char *text, size_t length) {
+	if (length > (size_t)(limit - out))
+		length = limit - out;
+	memcpy(out, text, length);
+	return out + length;
+}
+
+Grammar::Grammar() : _nameGenerator(0) {
+}
+
+bool Grammar::fail(int line, const std::string &message) {
+	char prefix[32] = "";
+	if (line > 0)
+		sprintf(prefix, "line %d: ", line);
+	_error = prefix + message;
+	return false;
+}
+
+uint32 Grammar::intern(const std::string &text) {
+	std::map<std::string, uint32>::iterator it = _interned.find(text);
+	if (it != _interned.end())
+		return it->second;
+
+	uint32 offset = (uint32)_text.size();
+	_text += text;
+	_interned[text] = offset;
+	return offset;
+}
+
+bool Grammar::parseTemplate(int line, const std::string &text, const std::vector<std::string> &names) {
+	Span alternative = { (uint32)_tokens.size(), 0 };
+	std::string literal;
+
+	for (size_t i = 0; i <= text.size(); i++) {
+		bool slot = i < text.size() && (text[i] == '<' || (text[i] == '$' && i + 1 < text.size() && text[i + 1] >= '1' && text[i + 1] <= '9'));
+		if ((slot || i == text.size()) && !literal.empty()) {
+			Token token = { kTokenText, 0, intern(literal), (uint32)literal.size() };
+			_tokens.push_back(token);
+			literal.clear();
+		}
+		if (i == text.size())
+			break;
+
+		if (text[i] == '\\' && i + 1 < text.size()) {
+			literal += text[++i];
+		} else if (text[i] == '$' && slot) {
+			Token token = { kTokenArgument, 0, (uint32)(text[++i] - '1'), 0 };
+			_tokens.push_back(token);
+		} else if (text[i] == '<') {
+			size_t close = text.find('>', i);
+			if (close == std::string::npos)
+				return fail(line, "missing '>'");
+
+			std::string name = text.substr(i + 1, close - i - 1);
+			bool capitalize = !name.empty() && name[0] == '^';
+			if (capitalize)
+				name.erase(0, 1);
+
+			size_t s = 0;
+			while (s < names.size() && names[s] != name)
+				s++;
+			if (s == names.size())
+				return fail(line, "unknown list or rule '" + name + "'");
+
+			Token token = { kTokenSymbol, (unsigned char)capitalize, (uint32)s, 0 };
+			_tokens.push_back(token);
+			i = close;
+		} else {
+			literal += text[i];
+		}
+	}
+
+	alternative.count = (uint32)_tokens.size() - alternative.first;
+	_alternatives.push_back(alternative);
+	return true;
+}
+
+// rules expanding into themselves would never end
+bool Grammar::checkCycles() {
+	// 0 unvisited, 1 on the path, 2 done
+	std::vector<char> state(_symbols.size(), 0);
+	std::vector<std::pair<int, uint32> > stack;
+
+	for (size_t root = 0; root < _symbols.size(); root++) {
+		if (state[root] || _symbols[root].kind != kSymbolRule)
+			continue;
+
+		// (symbol, next token) pairs of a depth first walk
+		state[root] = 1;
+		stack.push_back(std::make_pair((int)root, 0u));
+		while (!stack.empty()) {
+			const Symbol &symbol = _symbols[stack.back().first];
+			const Span &first = _alternatives[symbol.items.first];
+			const Span &last = _alternatives[symbol.items.first + symbol.items.count - 1];
+			uint32 end = last.first + last.count;
+
+			uint32 &t = stack.back().second;
+			if (t < first.first)
+				t = first.first;
+			if (t >= end) {
+				state[stack.back().first] = 2;
+				stack.pop_back();
+				continue;
+			}
+
+			const Token &token = _tokens[t++];
+			if (token.kind != kTokenSymbol || _symbols[token.value].kind != kSymbolRule)
+				continue;
+			if (state[token.value] == 1)
+				return fail(0, "rule '" + _names[token.value] + "' expands into itself");
+			if (state[token.value] == 0) {
+				state[token.value] = 1;
+				stack.push_back(std::make_pair((int)token.value, 0u));
+			}
+		}
+	}
+	return true;
+}
+
+bool Grammar::compile(const char *text, const char *baseDir) {
+	_text.clear();
+	_entries.clear();
+	_alternatives.clear();
+	_tokens.clear();
+	_symbols.clear();
+	_interned.clear();
+	_names.assign(1, "name");
+
+	Symbol name = { kSymbolName, { 0, 0 } };
+	_symbols.push_back(name);
+
+	// the definitions, then their names so that rules can refer forward
+	std::vector<std::string> lines;
+	std::istringstream input(text);
+	std::string line;
+	while (std::getline(input, line))
+		lines.push_back(line);
+
+	std::vector<int> defined(lines.size(), -1);
+	for (size_t n = 0; n < lines.size(); n++) {
+		std::istringstream words(lines[n]);
+		std::string keyword, symbol;
+		if (!(words >> keyword) || keyword[0] == '#')
+			continue;
+		if (keyword != "list" && keyword != "words" && keyword != "rule")
+			return fail((int)n + 1, "unknown definition '" + keyword + "'");
+		if (!(words >> symbol))
+			return fail((int)n + 1, "missing name");
+		for (size_t s = 0; s < _names.size(); s++)
+			if (_names[s] == symbol)
+				return fail((int)n + 1, "'" + symbol + "' is defined twice");
+
+		defined[n] = (int)_names.size();
+		_names.push_back(symbol);
+	}
+	_symbols.resize(_names.size());
+
+	for (size_t n = 0; n < lines.size(); n++) {
+		if (defined[n] < 0)
+			continue;
+
+		int lineNumber = (int)n + 1;
+		std::istringstream words(lines[n]);
+		std::string keyword, symbolName;
+		words >> keyword >> symbolName;
+		std::string rest;
+		std::getline(words, rest);
+
+		Symbol &symbol = _symbols[defined[n]];
+		if (keyword == "rule") {
+			rest = trim(rest);
+			if (rest.empty() || rest[0] != '=')
+				return fail(lineNumber, "expected '=' after the rule name");
+
+			std::vector<std::string> parts;
+			splitAlternatives(rest.substr(1), parts);
+			symbol.kind = kSymbolRule;
+			symbol.items.first = (uint32)_alternatives.size();
+			for (size_t i = 0; i < parts.size(); i++)
+				if (!parseTemplate(lineNumber, parts[i], _names))
+					return false;
+			symbol.items.count = (uint32)_alternatives.size() - symbol.items.first;
+			continue;
+		}
+
+		std::vector<std::string> entries;
+		if (keyword == "words") {
+			std::vector<std::string> parts;
+			splitAlternatives(rest, parts);
+			for (size_t i = 0; i < parts.size(); i++) {
+				// entries are plain text, only the escapes are resolved
+				std::string entry;
+				for (size_t c = 0; c < parts[i].size(); c++)
+					entry += parts[i][c] == '\\' && c + 1 < parts[i].size() ? parts[i][++c] : parts[i][c];
+				if (!entry.empty())
+					entries.push_back(entry);
+			}
+		} else {
+			std::istringstream files(rest);
+			std::string file;
+			while (files >> file) {
+				std::string path = file;
+				if (baseDir && *baseDir && file[0] != '/')
+					path = std::string(baseDir) + "/" + file;
+
+				std::string content;
+				if (!readFile(path.c_str(), content))
+					return fail(lineNumber, "cannot open " + path);
+
+				std::istringstream fileLines(content);
+				std::string entry;
+				while (std::getline(fileLines, entry)) {
+					entry = trim(entry);
+					if (!entry.empty())
+						entries.push_back(entry);
+				}
+			}
+		}
+
+		if (entries.empty())
+			return fail(lineNumber, "'" + symbolName + "' has no entries");
+
+		symbol.kind = kSymbolList;
+		symbol.items.first = (uint32)_entries.size();
+		symbol.items.count = (uint32)entries.size();
+		for (size_t i = 0; i < entries.size(); i++) {
+			Span entry = { intern(entries[i]), (uint32)entries[i].size() };
+			_entries.push_back(entry);
+		}
+	}
+
+	_interned.clear();
+	if (!checkCycles())
+		return false;
+
+	_error.clear();
+	return true;
+}
+
+bool Grammar::load(const char *path) {
+	std::string text;
+	if (!readFile(path, text))
+		return fail(0, std::string("cannot open ") + path);
+
+	std::string dir(path);
+	size_t slash = dir.find_last_of("/\\");
+	dir = slash == std::string::npos ? std::string() : dir.substr(0, slash);
+
+	return compile(text.c_str(), dir.c_str());
+}
+
+int Grammar::symbol(const char *name) const {
+	for (size_t s = 0; s < _names.size(); s++)
+		if (_names[s] == name)
+			return (int)s;
+	return -1;
+}
+
+char *Grammar::emit(int s, Seed &seed, const char *const *args, int numArgs, char *out, char *limit) const {
+	const Symbol &symbol = _symbols[s];
+
+	if (symbol.kind == kSymbolList) {
+		const Span &entry = _entries[symbol.items.first + seed.getBits(symbol.items.count)];
+		return append(out, limit, _text.data() + entry.first, entry.count);
+	}
+
+	if (symbol.kind == kSymbolName) {
+		const EnglishWordGenerator &gen = _nameGenerator ? *_nameGenerator : sharedNameGenerator();
+		char name[MAX_NAME_LEN];
+		while (!gen.generate(name, seed))
+			;
+		return append(out, limit, name, strlen(name));
+	}
+
+	const Span &alternative = _alternatives[symbol.items.first + seed.getBits(symbol.items.count)];
+	for (uint32 t = alternative.first; t < alternative.first + alternative.count; t++) {
+		const Token &token = _tokens[t];
+		char *start = out;
+
+		if (token.kind == kTokenText)
+			out = append(out, limit, _text.data() + token.value, token.length);
+		else if (token.kind == kTokenArgument && (int)token.value < numArgs && args[token.value])
+			out = append(out, limit, args[token.value], strlen(args[token.value]));
+		else if (token.kind == kTokenSymbol)
+			out = emit(token.value, seed, args, numArgs, out, limit);
+
+		if (token.capitalize && out > start)
+			*start = (char)toupper((unsigned char)*start);
+	}
+	return out;
+}
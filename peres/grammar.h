@@ -0,0 +1,115 @@
+#ifndef __GRAMMAR__
+#define __GRAMMAR__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "misc.h"
+
+class EnglishWordGenerator;
+
+// buffer size for callers that expand without knowing how long it gets
+#define GRAMMAR_MAX_TEXT	1024
+
+// Template expansion over word lists, for compound names and flavour text.
+//
+// One definition per line, '#' starting a comment:
+//
+//   list NAME FILE [FILE...]
+//   words NAME ENTRY | ENTRY ...
+//   rule NAME = TEMPLATE | TEMPLATE ...
+//
+// A list takes one entry per line of its files, concatenated, with paths
+// relative to the grammar file. A template is text with slots: <NAME> is
+// an entry of a list or an expansion of a rule, <^NAME> the same with the
+// first letter capitalized, and $1 .. $9 are the arguments of the call.
+// The builtin list 'name' holds the phonology names. '\' takes the next
+// character literally. Entries and templates of a symbol are drawn
+// uniformly.
+//
+// Everything compiles into flat immutable tables: every distinct string
+// once in a text pool, lists as spans of it and templates as token runs.
+// Expanding only reads them and writes straight into the caller's buffer,
+// so one Grammar serves any number of threads.
+class Grammar {
+
+	enum SymbolKind {
+		kSymbolList,
+		kSymbolRule,
+		kSymbolName
+	};
+
+	enum TokenKind {
+		kTokenText,
+		kTokenSymbol,
+		kTokenArgument
+	};
+
+	struct Span {
+		uint32	first;
+		uint32	count;
+	};
+
+	struct Symbol {
+		int		kind;
+		Span	items;			// entries of a list, alternatives of a rule
+	};
+
+	struct Token {
+		unsigned char	kind;
+		unsigned char	capitalize;
+		uint32			value;		// text offset, symbol or argument
+		uint32			length;		// of text
+	};
+
+	std::string					_text;
+	std::vector<Span>			_entries;		// text offset and length
+	std::vector<Span>			_alternatives;	// into _tokens
+	std::vector<Token>			_tokens;
+	std::vector<Symbol>			_symbols;
+	std::vector<std::string>	_names;			// [symbol]
+	std::map<std::string, uint32>	_interned;	// while compiling
+
+	const EnglishWordGenerator	*_nameGenerator;
+	std::string					_error;
+
+	bool fail(int line, const std::string &message);
+	uint32 intern(const std::string &text);
+	bool parseTemplate(int line, const std::string &text, const std::vector<std::string> &names);
+	bool checkCycles();
+
+	char *emit(int symbol, Seed &seed, const char *const *args, int numArgs, char *out, char *limit) const;
+
+public:
+	Grammar();
+
+	// baseDir is where list files are looked up, 0 for the current directory
+	bool compile(const char *text, const char *baseDir = 0);
+	bool load(const char *path);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	// -1 if there is no such list or rule
+	int symbol(const char *name) const;
+
+	// generator behind the 'name' list, which must outlive the grammar; by
+	// default a shared one with no blocklist or orthography
+	void setNameGenerator(const EnglishWordGenerator *generator) {
+		_nameGenerator = generator;
+	}
+
+	// expands symbol into buffer, at most size - 1 chars and a NUL, and
+	// returns the length; missing arguments expand to nothing
+	int expand(int symbol, Seed &seed, char *buffer, int size,
+		const char *const *args = 0, int numArgs = 0) const {
+
+		char *end = emit(symbol, seed, args, numArgs, buffer, buffer + size - 1);
+		*end = '\0';
+		return (int)(end - buffer);
+	}
+};
+
+#endif
@@ -1,4 +1,7 @@
 
+#include <string.h>
+
+#include "en_phonology.h"
 #include "it_phonology.h"
 #include "tactics.h"
 
@@ -203,7 +206,7 @@ static Segment seg_three_obstruent_1( "xt",  c_k, c_s, c_t );
 
 static Segment seg_null;
 
-void it_setupOnsets(SegmentDistribution &dist) {
+static void setupOnsets(SegmentDistribution &dist) {
 
 	dist.addItem( 5, seg_null);
 	dist.addItem( 10, seg_c_p );
@@ -283,7 +286,7 @@ void it_setupOnsets(SegmentDistribution &dist) {
 
 }
 
-void it_setupCodas(SegmentDistribution &dist) {
+static void setupCodas(SegmentDistribution &dist) {
 
 	dist.addItem( 1, seg_null);
 	dist.addItem( 10, seg_c_p );
@@ -365,7 +368,7 @@ void it_setupCodas(SegmentDistribution &dist) {
 
 }
 
-void it_setupNuclei(SegmentDistribution &dist) {
+static void setupNuclei(SegmentDistribution &dist) {
 
 	dist.addItem( 1, seg_sv_i );
 	dist.addItem( 1, seg_sv_u );
@@ -388,3 +391,47 @@ void it_setupNuclei(SegmentDistribution &dist) {
 	dist.addItem( 1, seg_diph_eschwa );
 
 }
+
+// the inventory segment with the same phonemes, the one with the same
+// spelling if there are several; -1 if there is none
+static int inventoryId(const Segment &seg) {
+	const SegmentInventory &inventory = en_inventory();
+
+	int found = -1;
+	for (int id = 0; id < inventory.size; id++) {
+		if (!(inventory[id] == seg))
+			continue;
+		if (!strcmp(inventory[id]._spelling, seg._spelling))
+			return id;
+		if (found < 0)
+			found = id;
+	}
+	return found;
+}
+
+static void toInventory(const SegmentDistribution &from, SegmentDistribution &to) {
+	for (int i = 0; i < from.size(); i++) {
+		Segment seg = from.item(i);
+		seg._id = inventoryId(seg);
+		if (seg._id >= 0)
+			to.addItem(from.frequency(i), seg);
+	}
+}
+
+void it_setupOnsets(SegmentDistribution &dist) {
+	SegmentDistribution all;
+	setupOnsets(all);
+	toInventory(all, dist);
+}
+
+void it_setupNuclei(SegmentDistribution &dist) {
+	SegmentDistribution all;
+	setupNuclei(all);
+	toInventory(all, dist);
+}
+
+void it_setupCodas(SegmentDistribution &dist) {
+	SegmentDistribution all;
+	setupCodas(all);
+	toInventory(all, dist);
+}
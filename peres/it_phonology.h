@@ -1,43 +1,16 @@
-
 #ifndef __IT_PHONOLOGY__
 #define __IT_PHONOLOGY__
 
 
 #include "phonetics.h"
-
-enum ItalianPhonemes {
-
-	VOWEL_I = 1,
-	VOWEL_U,
-	VOWEL_A,
-	VOWEL_OPENMID_E,
-	VOWEL_CLOSEMID_E,
-	VOWEL_OPENMID_O,
-	VOWEL_CLOSEMID_O,
-
-	CONSONANT_P,
-	CONSONANT_B,
-	CONSONANT_T,
-	CONSONANT_D,
-	CONSONANT_K,
-	CONSONANT_G,
-
-	CONSONANT_M,
-	CONSONANT_N,
-	CONSONANT_GN,
-
-	CONSONANT_F,
-	CONSONANT_V,
-	CONSONANT_S,
-	CONSONANT_Z,
-	CONSONANT_SH,
-
-	CONSONANT_CH,
-	CONSONANT_DJ,
-
-	CONSONANT_R,
-	CONSONANT_GL,
-	CONSONANT_L
-};
+#include "positions.h"
+
+// Italian weights and spellings over the English phonemes. The segments are
+// matched to en_inventory() by their phonemes, so the English rules and ids
+// apply to them and the tables blend with the English ones, see mixture.h;
+// segments the inventory lacks are left out.
+void it_setupOnsets(SegmentDistribution &dist);
+void it_setupNuclei(SegmentDistribution &dist);
+void it_setupCodas(SegmentDistribution &dist);
 
 #endif
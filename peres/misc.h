@@ -1,11 +1,30 @@
 #ifndef __MISC__
 #define __MISC__
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
 typedef unsigned int uint32;
+typedef unsigned long long uint64;
 
 class Seed {
 public:
 	virtual uint32 getBits(uint32 num) = 0;
+
+	// called before the draws of each word; quasi-random seeds move on to
+	// their next point, the others ignore it
+	virtual void beginSample() {
+	}
+
+	// draws are stratified and only keep that through lookups preserving
+	// their order, such as inverse CDF ones
+	virtual bool quasiRandom() const {
+		return false;
+	}
 };
 
 class NullSeed : public Seed {
@@ -31,6 +50,345 @@ public:
 	}
 };
 
+// Fixed capacity vector stored inline, it never allocates. push_back()
+// refuses elements past N instead of writing over the end.
+template <class T, int N>
+class InlineVector {
+
+	T	_items[N];
+	int	_size;
+
+public:
+	InlineVector() : _size(0) { }
+
+	bool push_back(const T &item) {
+		if (_size >= N)
+			return false;
+		_items[_size++] = item;
+		return true;
+	}
+
+	void clear() {
+		_size = 0;
+	}
+
+	int size() const {
+		return _size;
+	}
+
+	bool full() const {
+		return _size == N;
+	}
+
+	static int capacity() {
+		return N;
+	}
+
+	const T* data() const {
+		return _items;
+	}
+
+	T& operator[](int index) {
+		assert(index >= 0 && index < _size);
+		return _items[index];
+	}
+
+	const T& operator[](int index) const {
+		assert(index >= 0 && index < _size);
+		return _items[index];
+	}
+};
+
+// splitmix64 finalizer
+inline uint64 mix64(uint64 z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+#define FNV_BASIS			0xcbf29ce484222325ULL
+
+// FNV-1a over size bytes, continuing from hash
+inline uint64 fnv1a(uint64 hash, const void *data, size_t size) {
+	const unsigned char *p = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// FNV-1a of a 0 terminated string
+inline uint64 fnv1a(const char *text) {
+	uint64 hash = FNV_BASIS;
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		hash ^= *p;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// appends the whole file to text, false if it cannot be opened
+inline bool readFile(const char *path, std::string &text) {
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return false;
+
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		text.append(buffer, n);
+	fclose(f);
+	return true;
+}
+
+#define KEYED_SEED_STEP		0x9E3779B97F4A7C15ULL
+
+// Counter based stream: the n-th draw is a hash of (key, n) and nothing
+// else, so equal keys give equal sequences on every host and thread.
+// Callers that hashed the first draws in bulk hand them over as 'prefetched'.
+class KeyedSeed : public Seed {
+
+	uint64			_key;
+	uint64			_counter;
+	const uint64	*_prefetched;
+	uint64			_numPrefetched;
+
+public:
+	KeyedSeed(uint64 key) : _key(key), _counter(0), _prefetched(0), _numPrefetched(0) {
+	}
+	KeyedSeed(uint64 key, const uint64 *prefetched, int numPrefetched) :
+		_key(key), _counter(0), _prefetched(prefetched), _numPrefetched(numPrefetched) {
+	}
+
+	static uint64 draw(uint64 key, uint64 n) {
+		return mix64(key + n * KEYED_SEED_STEP);
+	}
+
+	uint32 getBits(uint32 num) {
+		uint64 x = (_counter < _numPrefetched) ? _prefetched[_counter] : draw(_key, _counter + 1);
+		_counter++;
+		// multiply-shift keeps the high bits and avoids the modulo bias of %
+		return (uint32)(((x >> 32) * num) >> 32);
+	}
+};
+
+// dimensions with Sobol direction numbers, enough for the draws of a word
+// of MAX_SYLLABLES syllables and its syllable count
+#define SOBOL_DIMENSIONS	16
+
+// Quasi-random draws. Every word is one point of a Sobol sequence and its
+// successive draws take successive coordinates, so inverse CDF lookups
+// spread the words evenly over the joint space of segments while each draw
+// alone is still uniform, keeping the marginal probabilities. Alias tables
+// would scatter the strata; quasiRandom() tells the generators to use the
+// cumulative lookup. A digital shift per dimension derived from the key
+// gives independent streams.
+// Draws past SOBOL_DIMENSIONS, as after rejected syllables, are hashed.
+class SobolSeed : public Seed {
+
+	uint32	_directions[SOBOL_DIMENSIONS][32];
+	uint32	_point[SOBOL_DIMENSIONS];
+	uint32	_shift[SOBOL_DIMENSIONS];
+	uint64	_key;
+	uint64	_index;
+	int		_dimension;
+
+public:
+	SobolSeed(uint64 key) : _key(key), _index(0), _dimension(0) {
+		// Joe and Kuo: degree, polynomial coefficients, initial m values
+		static const struct {
+			int		degree;
+			uint32	coefficients;
+			uint32	m[6];
+		} table[SOBOL_DIMENSIONS - 1] = {
+			{ 1, 0,  { 1 } },
+			{ 2, 1,  { 1, 3 } },
+			{ 3, 1,  { 1, 3, 1 } },
+			{ 3, 2,  { 1, 1, 1 } },
+			{ 4, 1,  { 1, 1, 3, 3 } },
+			{ 4, 4,  { 1, 3, 5, 13 } },
+			{ 5, 2,  { 1, 1, 5, 5, 17 } },
+			{ 5, 4,  { 1, 1, 5, 5, 5 } },
+			{ 5, 7,  { 1, 1, 7, 11, 19 } },
+			{ 5, 11, { 1, 1, 5, 1, 1 } },
+			{ 5, 13, { 1, 1, 1, 3, 11 } },
+			{ 5, 14, { 1, 3, 5, 5, 31 } },
+			{ 6, 1,  { 1, 3, 3, 9, 7, 49 } },
+			{ 6, 13, { 1, 1, 1, 15, 21, 21 } },
+			{ 6, 16, { 1, 3, 1, 13, 27, 49 } },
+		};
+
+		for (int k = 0; k < 32; k++)
+			_directions[0][k] = (uint32)1 << (31 - k);
+
+		for (int d = 1; d < SOBOL_DIMENSIONS; d++) {
+			int s = table[d - 1].degree;
+			uint32 a = table[d - 1].coefficients;
+			uint32 *v = _directions[d];
+
+			for (int k = 0; k < s; k++)
+				v[k] = table[d - 1].m[k] << (31 - k);
+			for (int k = s; k < 32; k++) {
+				v[k] = v[k - s] ^ (v[k - s] >> s);
+				for (int j = 1; j < s; j++)
+					if ((a >> (s - 1 - j)) & 1)
+						v[k] ^= v[k - j];
+			}
+		}
+
+		for (int d = 0; d < SOBOL_DIMENSIONS; d++) {
+			_shift[d] = (uint32)(mix64(key + (d + 1) * KEYED_SEED_STEP) >> 32);
+			_point[d] = 0;
+		}
+	}
+
+	// point i + 1 differs from point i by the direction numbers of the
+	// lowest zero bit of i (Gray code order)
+	void beginSample() {
+		if (_index > 0) {
+			uint64 i = _index - 1;
+			int bit = 0;
+			while ((i & 1) && bit < 31) {
+				i >>= 1;
+				bit++;
+			}
+
+			for (int d = 0; d < SOBOL_DIMENSIONS; d++)
+				_point[d] ^= _directions[d][bit];
+		}
+		_index++;
+		_dimension = 0;
+	}
+
+	bool quasiRandom() const {
+		return true;
+	}
+
+	uint32 getBits(uint32 num) {
+		uint64 x;
+		if (_dimension < SOBOL_DIMENSIONS)
+			x = (uint64)(_point[_dimension] ^ _shift[_dimension]) << 32;
+		else
+			x = KeyedSeed::draw(_key ^ _index, _dimension);
+		_dimension++;
+		return (uint32)(((x >> 32) * num) >> 32);
+	}
+};
+
+#define MT_N	624
+#define MT_M	397
+
+// Python's random.Random: MT19937 seeded the way random.seed(n) seeds it
+// for an integer n, with getBits(num) returning what randrange(num) does in
+// Python 2, so ports of the Python scripts draw the same numbers seed for
+// seed. Until the first MT_N - MT_M outputs are used up they are computed
+// from the seeded state one at a time, which saves the full twist for the
+// short streams of a single name.
+class PythonSeed : public Seed {
+
+	uint32	_mt[MT_N];
+	int		_index;
+	bool	_twisted;
+
+	static uint32 mix(uint32 a, uint32 b, uint32 c) {
+		uint32 y = (a & 0x80000000U) | (b & 0x7fffffffU);
+		return c ^ (y >> 1) ^ ((y & 1) ? 0x9908b0dfU : 0);
+	}
+
+	void twist() {
+		for (int i = 0; i < MT_N; i++)
+			_mt[i] = mix(_mt[i], _mt[(i + 1) % MT_N], _mt[(i + MT_M) % MT_N]);
+	}
+
+	uint32 next() {
+		uint32 y;
+		if (!_twisted && _index < MT_N - MT_M) {
+			y = mix(_mt[_index], _mt[_index + 1], _mt[_index + MT_M]);
+			_index++;
+		} else {
+			if (!_twisted) {
+				twist();
+				_twisted = true;
+			} else if (_index >= MT_N) {
+				twist();
+				_index = 0;
+			}
+			y = _mt[_index++];
+		}
+
+		y ^= y >> 11;
+		y ^= (y << 7) & 0x9d2c5680U;
+		y ^= (y << 15) & 0xefc60000U;
+		return y ^ (y >> 18);
+	}
+
+public:
+	PythonSeed(long long seed) {
+		setSeed(seed);
+	}
+
+	// a seed given by sign and magnitude, which reaches past long long
+	PythonSeed(bool negative, uint64 magnitude) {
+		setSeed(negative, magnitude);
+	}
+
+	void setSeed(long long seed) {
+		setSeed(seed < 0, seed < 0 ? 0 - (uint64)seed : (uint64)seed);
+	}
+
+	// init_by_array() over the 32 bit words of |seed|, as CPython does, so
+	// the sign does not enter
+	void setSeed(bool, uint64 n) {
+		uint32 key[2] = { (uint32)n, (uint32)(n >> 32) };
+		int keyLength = key[1] ? 2 : 1;
+
+		// init_genrand(19650218) is the same for every seed
+		static const struct InitialState {
+			uint32	mt[MT_N];
+			InitialState() {
+				mt[0] = 19650218U;
+				for (int i = 1; i < MT_N; i++)
+					mt[i] = 1812433253U * (mt[i - 1] ^ (mt[i - 1] >> 30)) + i;
+			}
+		} initial;
+		memcpy(_mt, initial.mt, sizeof(_mt));
+
+		int i = 1, j = 0;
+		for (int k = MT_N; k; k--) {
+			_mt[i] = (_mt[i] ^ ((_mt[i - 1] ^ (_mt[i - 1] >> 30)) * 1664525U)) + key[j] + j;
+			if (++i >= MT_N) {
+				_mt[0] = _mt[MT_N - 1];
+				i = 1;
+			}
+			if (++j >= keyLength)
+				j = 0;
+		}
+		for (int k = MT_N - 1; k; k--) {
+			_mt[i] = (_mt[i] ^ ((_mt[i - 1] ^ (_mt[i - 1] >> 30)) * 1566083941U)) - i;
+			if (++i >= MT_N) {
+				_mt[0] = _mt[MT_N - 1];
+				i = 1;
+			}
+		}
+		_mt[0] = 0x80000000U;
+
+		_index = 0;
+		_twisted = false;
+	}
+
+	// random.random(), 53 bits
+	double random() {
+		uint32 a = next() >> 5;
+		uint32 b = next() >> 6;
+		return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+	}
+
+	uint32 getBits(uint32 num) {
+		return (uint32)(random() * num);
+	}
+};
+
 class SeededGenerator {
 protected:
 	Seed &_seed;
@@ -69,22 +427,106 @@ public:
 
 	T getItem(int value) const {
 
+		// value is drawn from [0, cumFreq), item i owns [cumFreq(i-1), cumFreq(i))
 		int i;
-		for (i = 0; i < _numItems; i++)
-			if (value <= _cumFreqs[i])
+		for (i = 0; i < _numItems - 1; i++)
+			if (value < _cumFreqs[i])
 				break;
 
 		return _items[i];
 	}
 
-	int size() {
+	// same by binary search, for long distributions
+	const T& findItem(int value) const {
+		int i = (int)(std::upper_bound(_cumFreqs.begin(), _cumFreqs.end(), value) - _cumFreqs.begin());
+		return _items[i < _numItems ? i : _numItems - 1];
+	}
+
+	const T& item(int index) const {
+		return _items[index];
+	}
+
+	int frequency(int index) const {
+		return _cumFreqs[index] - (index > 0 ? _cumFreqs[index - 1] : 0);
+	}
+
+	int size() const {
 		return _numItems;
 	}
 
-	int cumFreq() {
+	int cumFreq() const {
 		return _cumFreq;
 	}
 
 };
 
+// Walker's alias method over a Distribution: every value of range() falls
+// into one of size() equal columns, each split between its own item and
+// one alias, so a draw is a division and a compare instead of a scan. The
+// split points are integers, which keeps the item probabilities exact.
+// Neighbouring values end up with unrelated items, so stratified draws go
+// through getOrderedItem() instead.
+template <class T>
+class AliasTable {
+
+	Distribution<T>		_dist;
+	std::vector<uint32>	_cut;		// [column] values below it pick the column's item
+	std::vector<int>	_alias;
+	uint32				_columnSize;
+
+public:
+	AliasTable() : _columnSize(1) { }
+
+	AliasTable(const Distribution<T> &dist) : _dist(dist), _columnSize(dist.cumFreq()) {
+		int n = dist.size();
+		assert(n > 0 && (uint64)n * _columnSize < ((uint64)1 << 32));
+
+		// weights scaled so that every column holds exactly cumFreq
+		std::vector<uint64> weight(n);
+		std::vector<int> small, large;
+		for (int i = 0; i < n; i++) {
+			weight[i] = (uint64)dist.frequency(i) * n;
+			(weight[i] < _columnSize ? small : large).push_back(i);
+		}
+
+		_cut.assign(n, _columnSize);
+		_alias.resize(n);
+		for (int i = 0; i < n; i++)
+			_alias[i] = i;
+
+		while (!small.empty() && !large.empty()) {
+			int s = small.back();
+			int l = large.back();
+			small.pop_back();
+
+			_cut[s] = (uint32)weight[s];
+			_alias[s] = l;
+			weight[l] -= _columnSize - weight[s];
+			if (weight[l] < _columnSize) {
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+	}
+
+	// draws are values in [0, range())
+	uint32 range() const {
+		return (uint32)_dist.size() * _columnSize;
+	}
+
+	const T& getItem(uint32 value) const {
+		uint32 column = value / _columnSize;
+		return _dist.item(value - column * _columnSize < _cut[column] ? column : _alias[column]);
+	}
+
+	// by inverse CDF, values in [0, distribution().cumFreq())
+	const T& getOrderedItem(uint32 value) const {
+		return _dist.findItem((int)value);
+	}
+
+	const Distribution<T> &distribution() const {
+		return _dist;
+	}
+};
+
 #endif
@@ -0,0 +1,160 @@
+#include <limits.h>
+#include <string.h>
+
+#include <vector>
+
+#include "mixture.h"
+#include "generator.h"
+#include "it_phonology.h"
+
+struct PhonologyMixer::Entry {
+	uint32				key;
+	PositionalTables	tables;
+	Entry				*next;		// set before the entry is published, never after
+
+	Entry(uint32 key, const Phonotactics &rules, const SegmentDistribution *dists) :
+		key(key), tables(rules, dists), next(0) {
+	}
+};
+
+static uint64 gcd(uint64 a, uint64 b) {
+	while (b) {
+		uint64 t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+PhonologyMixer::PhonologyMixer() : _numMixtures(0), _rules(en_phonotactics()) {
+	en_setupOnsets(_dists[kLanguageEnglish][kSlotOnset]);
+	en_setupNuclei(_dists[kLanguageEnglish][kSlotNucleus]);
+	en_setupCodas(_dists[kLanguageEnglish][kSlotCoda]);
+	it_setupOnsets(_dists[kLanguageItalian][kSlotOnset]);
+	it_setupNuclei(_dists[kLanguageItalian][kSlotNucleus]);
+	it_setupCodas(_dists[kLanguageItalian][kSlotCoda]);
+
+	for (int i = 0; i < MIXTURE_BUCKETS; i++)
+		_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+PhonologyMixer::~PhonologyMixer() {
+	for (int i = 0; i < MIXTURE_BUCKETS; i++) {
+		Entry *entry = _buckets[i].load(std::memory_order_relaxed);
+		while (entry) {
+			Entry *next = entry->next;
+			delete entry;
+			entry = next;
+		}
+	}
+}
+
+// steps[language] summing to MIXTURE_STEPS, and a key telling them apart
+uint32 PhonologyMixer::quantize(const double *weights, int *steps) {
+	double sum = 0;
+	for (int l = 0; l < kNumLanguages; l++)
+		sum += weights[l] > 0 ? weights[l] : 0;
+
+	int total = 0, largest = 0;
+	for (int l = 0; l < kNumLanguages; l++) {
+		steps[l] = sum > 0 && weights[l] > 0 ? (int)(weights[l] / sum * MIXTURE_STEPS + 0.5) : 0;
+		total += steps[l];
+		if (steps[l] > steps[largest])
+			largest = l;
+	}
+	if (total == 0)
+		steps[kLanguageEnglish] = total = MIXTURE_STEPS;
+
+	// rounding may miss the sum by a step or so
+	steps[largest] += MIXTURE_STEPS - total;
+
+	uint32 key = 0;
+	for (int l = kNumLanguages - 1; l >= 0; l--)
+		key = key * (MIXTURE_STEPS + 1) + steps[l];
+	return key;
+}
+
+PhonologyMixer::Entry *PhonologyMixer::find(Entry *entry, const Entry *end, uint32 key) {
+	for (; entry != end; entry = entry->next)
+		if (entry->key == key)
+			return entry;
+	return 0;
+}
+
+void PhonologyMixer::blend(const int *steps, SegmentDistribution *dists) const {
+	for (int slot = 0; slot < kNumSlots; slot++) {
+
+		// the shares of all languages over one denominator
+		uint64 denominator = 1;
+		for (int l = 0; l < kNumLanguages; l++) {
+			uint64 cum = _dists[l][slot].cumFreq();
+			if (steps[l] > 0)
+				denominator = denominator / gcd(denominator, cum) * cum;
+		}
+
+		std::vector<Segment> items;
+		std::vector<uint64> weights;
+		for (int l = 0; l < kNumLanguages; l++) {
+			if (steps[l] == 0)
+				continue;
+
+			const SegmentDistribution &dist = _dists[l][slot];
+			uint64 scale = steps[l] * (denominator / dist.cumFreq());
+			for (int i = 0; i < dist.size(); i++) {
+				const Segment &seg = dist.item(i);
+
+				size_t k;
+				for (k = 0; k < items.size(); k++)
+					if (items[k]._id == seg._id && !strcmp(items[k]._spelling, seg._spelling))
+						break;
+				if (k == items.size()) {
+					items.push_back(seg);
+					weights.push_back(0);
+				}
+				weights[k] += dist.frequency(i) * scale;
+			}
+		}
+
+		uint64 divisor = 0;
+		for (size_t k = 0; k < weights.size(); k++)
+			divisor = gcd(divisor, weights[k]);
+
+		assert(MIXTURE_STEPS * denominator / divisor <= INT_MAX);
+		for (size_t k = 0; k < items.size(); k++)
+			dists[slot].addItem((int)(weights[k] / divisor), items[k]);
+	}
+}
+
+const PositionalTables &PhonologyMixer::tables(const double *weights) {
+	int steps[kNumLanguages];
+	uint32 key = quantize(weights, steps);
+	std::atomic<Entry *> &bucket = _buckets[key % MIXTURE_BUCKETS];
+
+	Entry *head = bucket.load(std::memory_order_acquire);
+	Entry *found = find(head, 0, key);
+	if (found)
+		return found->tables;
+
+	SegmentDistribution dists[kNumSlots];
+	blend(steps, dists);
+	Entry *entry = new Entry(key, _rules, dists);
+
+	entry->next = head;
+	while (!bucket.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_acquire)) {
+		// only the entries pushed since the last look can be new
+		found = find(entry->next, head, key);
+		if (found) {
+			delete entry;
+			return found->tables;
+		}
+		head = entry->next;
+	}
+
+	_numMixtures.fetch_add(1, std::memory_order_relaxed);
+	return entry->tables;
+}
+
+const PositionalTables &mixedTables(const double *weights) {
+	static PhonologyMixer mixer;
+	return mixer.tables(weights);
+}
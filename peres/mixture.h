@@ -0,0 +1,70 @@
+#ifndef __MIXTURE__
+#define __MIXTURE__
+
+#include <atomic>
+
+#include "misc.h"
+#include "positions.h"
+
+// weights are rounded to multiples of 1 / MIXTURE_STEPS, which bounds the
+// number of distinct mixtures
+#define MIXTURE_STEPS		64
+#define MIXTURE_BUCKETS		256
+
+// the phonologies a mixture blends, all over en_inventory()
+enum Language {
+	kLanguageEnglish,
+	kLanguageItalian,
+	kNumLanguages
+};
+
+// Positional tables blending the languages' onset, nucleus and coda tables
+// by weight, for regions whose names mix phonologies.
+//
+// A segment's weight in a mixture is the sum over the languages of its
+// share in that language's table times the language weight; the shares are
+// brought to a common denominator so the blend is exact, and a segment
+// spelled alike in several languages becomes one entry. The result is
+// frozen into PositionalTables like a single language, so drawing from a
+// mixture costs the same.
+//
+// Mixtures are built on first use and kept until the mixer goes: every
+// bucket is a list of immutable entries that only ever grows at its head.
+// Lookups are plain acquire loads, a new entry is published with a
+// compare-and-swap, so any number of threads share the cache without a
+// lock. Threads asking for the same new mixture at once may each build it;
+// one copy wins and the others are thrown away.
+class PhonologyMixer {
+
+	struct Entry;
+
+	SegmentDistribution			_dists[kNumLanguages][kNumSlots];
+	std::atomic<Entry *>		_buckets[MIXTURE_BUCKETS];
+	std::atomic<int>			_numMixtures;
+	const Phonotactics			&_rules;
+
+	static uint32 quantize(const double *weights, int *steps);
+	static Entry *find(Entry *entry, const Entry *end, uint32 key);
+	void blend(const int *steps, SegmentDistribution *dists) const;
+
+	PhonologyMixer(const PhonologyMixer &);
+	PhonologyMixer &operator=(const PhonologyMixer &);
+
+public:
+	PhonologyMixer();
+	~PhonologyMixer();
+
+	// weights[kNumLanguages], not negative and not all 0; only their ratios
+	// count. The tables live as long as the mixer.
+	const PositionalTables &tables(const double *weights);
+
+	// mixtures built so far
+	int numMixtures() const {
+		return _numMixtures.load(std::memory_order_relaxed);
+	}
+};
+
+// the tables of a process wide mixer
+const PositionalTables &mixedTables(const double *weights);
+
+#endif
@@ -0,0 +1,187 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+
+#include "model.h"
+#include "generator.h"
+
+static const char *slotNames[kNumSlots] = { "onset", "nucleus", "coda" };
+
+PhonologyModel::PhonologyModel() : _rules(en_phonotactics()) {
+	SegmentDistribution dists[kNumSlots];
+	en_setupOnsets(dists[kSlotOnset]);
+	en_setupNuclei(dists[kSlotNucleus]);
+	en_setupCodas(dists[kSlotCoda]);
+	_tables = PositionalTables(_rules, dists);
+}
+
+bool PhonologyModel::fail(int line, const std::string &message) {
+	char prefix[32] = "";
+	if (line > 0)
+		sprintf(prefix, "line %d: ", line);
+	_error = prefix + message;
+	return false;
+}
+
+bool PhonologyModel::parseWeights(const char *text, SegmentDistribution *dists) {
+	const SegmentInventory &inventory = en_inventory();
+	std::istringstream lines(text);
+	std::string line;
+
+	for (int number = 1; std::getline(lines, line); number++) {
+		std::istringstream in(line.substr(0, line.find('#')));
+		std::vector<std::string> words;
+		std::string word;
+
+		while (in >> word)
+			words.push_back(word);
+		if (words.empty())
+			continue;
+		if (words.size() != 4)
+			return fail(number, "usage: onset|nucleus|coda ID SPELLING WEIGHT");
+
+		int slot;
+		for (slot = 0; slot < kNumSlots; slot++)
+			if (words[0] == slotNames[slot])
+				break;
+		if (slot == kNumSlots)
+			return fail(number, "unknown slot '" + words[0] + "'");
+
+		if (!isdigit((unsigned char)words[1][0]) || !isdigit((unsigned char)words[3][0]))
+			return fail(number, "ID and WEIGHT are numbers");
+		if (words[3].size() > 6)
+			return fail(number, "WEIGHT is at most 999999");
+		int id = atoi(words[1].c_str());
+		int weight = atoi(words[3].c_str());
+		if (id >= inventory.size)
+			return fail(number, "no segment " + words[1]);
+		if ((id == 0) != (words[2] == "-") || (id == 0 && slot == kSlotNucleus))
+			return fail(number, "'-' is the empty onset or coda, ID 0");
+
+		Segment seg;
+		if (id > 0) {
+			seg = inventory[id];
+			seg._spelling = _spellings.add(words[2].c_str()).text;
+		}
+		dists[slot].addItem(weight, seg);
+	}
+
+	// the alias tables split the total weight into one column per entry
+	for (int slot = 0; slot < kNumSlots; slot++) {
+		if (dists[slot].size() == 0)
+			return fail(0, std::string("no ") + slotNames[slot] + " weights");
+		if ((uint64)dists[slot].size() * dists[slot].cumFreq() >= ((uint64)1 << 32))
+			return fail(0, std::string(slotNames[slot]) + " weights too large");
+	}
+	return true;
+}
+
+bool PhonologyModel::load(const char *weightsPath, const char *rulesPath) {
+	std::string text;
+	if (!readFile(weightsPath, text))
+		return fail(0, std::string("cannot open ") + weightsPath);
+
+	_error.clear();
+	_spellings.release();
+
+	SegmentDistribution dists[kNumSlots];
+	if (!parseWeights(text.c_str(), dists))
+		return false;
+
+	if (rulesPath && !_rules.load(rulesPath, en_inventory()))
+		return fail(0, std::string(rulesPath) + ": " + _rules.error());
+	if (!rulesPath)
+		_rules = en_phonotactics();
+
+	// generators would draw from such tables forever
+	_tables = PositionalTables(_rules, dists);
+	if (_tables.numEmpty() > 0)
+		return fail(0, "the rules reject every syllable of some position");
+	for (int n = 1; n <= MAX_SYLLABLES; n++) {
+		if (!_tables.hasWords(n))
+			return fail(0, "the rules reject every word of " + std::to_string(n) + " syllables");
+	}
+	return true;
+}
+
+void writeWeights(FILE *out, const SegmentDistribution *dists) {
+	fprintf(out, "# slot id spelling weight\n");
+	for (int slot = 0; slot < kNumSlots; slot++) {
+		const SegmentDistribution &dist = dists[slot];
+		for (int i = 0; i < dist.size(); i++) {
+			const Segment &seg = dist.item(i);
+			bool empty = seg._numItems == 0;
+			fprintf(out, "%s %d %s %d\n", slotNames[slot], empty ? 0 : seg._id, empty ? "-" : seg._spelling, dist.frequency(i));
+		}
+	}
+}
+
+LiveModel::LiveModel(const PhonologyModel *model) : _current(model), _epoch(1), _numReaders(0) {
+	for (int i = 0; i < LIVE_MODEL_READERS; i++)
+		_readers[i].epoch.store(kIdle, std::memory_order_relaxed);
+}
+
+LiveModel::~LiveModel() {
+	for (size_t i = 0; i < _retired.size(); i++)
+		delete _retired[i].model;
+	delete _current.load();
+}
+
+int LiveModel::addReader() {
+	int reader = _numReaders.fetch_add(1);
+	if (reader < LIVE_MODEL_READERS)
+		return reader;
+	_numReaders.fetch_sub(1);
+	return -1;
+}
+
+bool LiveModel::reload(const char *weightsPath, const char *rulesPath) {
+	PhonologyModel *model = new PhonologyModel;
+	if (!model->load(weightsPath, rulesPath)) {
+		std::lock_guard<std::mutex> guard(_reloadLock);
+		_error = model->error();
+		delete model;
+		return false;
+	}
+
+	publish(model);
+	return true;
+}
+
+void LiveModel::publish(const PhonologyModel *model) {
+	std::lock_guard<std::mutex> guard(_reloadLock);
+
+	// a reader that sees the new epoch entered after the swap and holds the
+	// new model; one announcing an older epoch may hold the old one
+	const PhonologyModel *old = _current.exchange(model);
+	Retired retired = { old, _epoch.fetch_add(1) };
+	_retired.push_back(retired);
+
+	reclaimLocked();
+}
+
+int LiveModel::reclaim() {
+	std::lock_guard<std::mutex> guard(_reloadLock);
+	return reclaimLocked();
+}
+
+int LiveModel::reclaimLocked() {
+	uint64 oldest = _epoch.load();
+	for (int i = 0; i < LIVE_MODEL_READERS; i++) {
+		uint64 epoch = _readers[i].epoch.load();
+		if (epoch != kIdle && epoch < oldest)
+			oldest = epoch;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < _retired.size(); i++) {
+		if (_retired[i].epoch < oldest)
+			delete _retired[i].model;
+		else
+			_retired[kept++] = _retired[i];
+	}
+	_retired.resize(kept);
+	return (int)kept;
+}
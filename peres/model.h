@@ -0,0 +1,163 @@
+#ifndef __MODEL__
+#define __MODEL__
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "misc.h"
+#include "arena.h"
+#include "phonotactics.h"
+#include "positions.h"
+
+// threads that can read a LiveModel at the same time
+#define LIVE_MODEL_READERS		64
+
+// A phonology loaded from disk and frozen for generation: rules and the
+// positional tables drawn under them, over the English inventory.
+//
+// The weights file has one table entry per line, '#' starting a comment:
+//
+//   onset|nucleus|coda ID SPELLING WEIGHT
+//
+// ID is the segment's index in en_inventory() and SPELLING how the table
+// writes it, '-' for the empty onset or coda, which is ID 0. writeWeights()
+// produces such a file from distributions, to be edited and loaded back.
+// The rules file is in the language of phonotactics.h.
+class PhonologyModel {
+
+	Phonotactics		_rules;
+	PositionalTables	_tables;
+	NameArena			_spellings;
+	std::string			_error;
+
+	bool fail(int line, const std::string &message);
+	bool parseWeights(const char *text, SegmentDistribution *dists);
+
+	PhonologyModel(const PhonologyModel &);
+	PhonologyModel &operator=(const PhonologyModel &);
+
+public:
+	// the English tables and rules
+	PhonologyModel();
+
+	// rulesPath 0 for the English rules; false on errors, see error(), which
+	// leave the model unusable
+	bool load(const char *weightsPath, const char *rulesPath);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	const Phonotactics &rules() const {
+		return _rules;
+	}
+
+	const PositionalTables &tables() const {
+		return _tables;
+	}
+};
+
+// dists are the onset, nucleus and coda tables
+void writeWeights(FILE *out, const SegmentDistribution *dists);
+
+// The current PhonologyModel of a long running process, replaced while
+// generation goes on.
+//
+// A new model is built completely by reload() on the caller's thread and
+// then published with one atomic pointer swap, so readers see either the
+// old or the new one, never a part. The old one is freed once no reader
+// can still hold it, by epoch based reclamation: a reader announces the
+// epoch it entered in, its own cache line in a fixed table, and a model
+// retired in epoch e is freed when every active reader announces a later
+// one. Readers therefore never wait or take a lock, entering is two
+// loads and a store; reloads take a lock among themselves only.
+//
+// Pin the model for a batch of names rather than for each one: until a
+// reader leaves, models retired after it entered stay allocated.
+class LiveModel {
+
+	struct alignas(64) Reader {
+		std::atomic<uint64>		epoch;		// kIdle when outside
+	};
+
+	struct Retired {
+		const PhonologyModel	*model;
+		uint64					epoch;
+	};
+
+	enum {
+		kIdle = 0
+	};
+
+	std::atomic<const PhonologyModel *>	_current;
+	alignas(64) std::atomic<uint64>		_epoch;
+	Reader								_readers[LIVE_MODEL_READERS];
+	std::atomic<int>					_numReaders;
+
+	std::mutex							_reloadLock;
+	std::vector<Retired>				_retired;
+	std::string							_error;
+
+	int reclaimLocked();
+
+	LiveModel(const LiveModel &);
+	LiveModel &operator=(const LiveModel &);
+
+public:
+	// takes ownership of model
+	LiveModel(const PhonologyModel *model);
+
+	// no reader may be inside any more
+	~LiveModel();
+
+	// a slot for one reading thread, -1 if all are taken
+	int addReader();
+
+	// the current model, valid until leave(); a reader must not enter twice
+	const PhonologyModel &enter(int reader) {
+		Reader &r = _readers[reader];
+		r.epoch.store(_epoch.load());
+		return *_current.load();
+	}
+
+	void leave(int reader) {
+		_readers[reader].epoch.store(kIdle, std::memory_order_release);
+	}
+
+	// enters for a scope
+	class Pin {
+		LiveModel				&_live;
+		int						_reader;
+		const PhonologyModel	&_model;
+	public:
+		Pin(LiveModel &live, int reader) : _live(live), _reader(reader), _model(live.enter(reader)) {
+		}
+		~Pin() {
+			_live.leave(_reader);
+		}
+		const PhonologyModel &model() const {
+			return _model;
+		}
+	};
+
+	// loads and publishes a new model; false if it does not load, see
+	// error(), and the current one stays
+	bool reload(const char *weightsPath, const char *rulesPath);
+
+	// publishes a model, taking ownership
+	void publish(const PhonologyModel *model);
+
+	// frees the retired models no reader can hold, returns the number still
+	// waiting; publishing does this as well
+	int reclaim();
+
+	const std::string &error() const {
+		return _error;
+	}
+};
+
+#endif
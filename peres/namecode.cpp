@@ -0,0 +1,115 @@
+#include "namecode.h"
+#include "en_phonology.h"
+
+#define MAX_CODE	0xFFFFFFFFFFFFFFFFULL
+
+NameCodec::NameCodec(const SegmentInventory &inventory) :
+	_inventory(inventory), _digit(inventory.size, 0), _vowel(inventory.size, 0), _maxSyllables(0) {
+
+	// id 0 is the empty onset and coda, digit 0
+	for (int id = 1; id < inventory.size; id++) {
+		const Segment &seg = inventory[id];
+		_vowel[id] = seg._numItems > 0 && (seg.first()._props & MASK_VOWEL) != 0;
+		if (_vowel[id]) {
+			_digit[id] = (int)_vowels.size();
+			_vowels.push_back(id);
+		} else {
+			_consonants.push_back(id);
+			_digit[id] = (int)_consonants.size();
+		}
+	}
+
+	uint64 margins = _consonants.size() + 1;
+	uint64 syllable = margins * _vowels.size();
+
+	// words of n syllables: syllable^n * margins for the last coda
+	uint64 words = margins;
+	_first[1] = 1;
+	for (int n = 1; n <= MAX_SYLLABLES; n++) {
+		if (words > MAX_CODE / syllable)
+			break;
+		words *= syllable;
+		if (_first[n] > MAX_CODE - words)
+			break;
+		_first[n + 1] = _first[n] + words;
+		_maxSyllables = n;
+	}
+}
+
+NameCode NameCodec::encode(const Syllable *syl, int numSyllables) const {
+	if (numSyllables < 1 || numSyllables > _maxSyllables)
+		return 0;
+
+	uint64 margins = _consonants.size() + 1;
+	uint64 nuclei = _vowels.size();
+	uint64 value = 0;
+
+	for (int i = 0; i < numSyllables; i++) {
+		const Syllable &s = syl[i];
+		if (s.hasOnset() && _vowel[s.onset._id])
+			return 0;
+		if (!_vowel[s.nucleus._id] || (i < numSyllables - 1 && s.hasCoda()))
+			return 0;
+
+		value = value * margins + (s.hasOnset() ? _digit[s.onset._id] : 0);
+		value = value * nuclei + _digit[s.nucleus._id];
+	}
+
+	const Syllable &last = syl[numSyllables - 1];
+	if (last.hasCoda() && _vowel[last.coda._id])
+		return 0;
+	value = value * margins + (last.hasCoda() ? _digit[last.coda._id] : 0);
+
+	return _first[numSyllables] + value;
+}
+
+int NameCodec::decode(NameCode code, Syllable *syl) const {
+	if (code == 0 || code >= _first[_maxSyllables + 1])
+		return 0;
+
+	int n = 1;
+	while (code >= _first[n + 1])
+		n++;
+
+	uint64 margins = _consonants.size() + 1;
+	uint64 nuclei = _vowels.size();
+	uint64 value = code - _first[n];
+
+	int digit = (int)(value % margins);
+	value /= margins;
+	syl[n - 1].coda = digit ? _inventory[_consonants[digit - 1]] : Segment();
+
+	for (int i = n - 1; i >= 0; i--) {
+		syl[i].nucleus = _inventory[_vowels[value % nuclei]];
+		value /= nuclei;
+
+		digit = (int)(value % margins);
+		value /= margins;
+		syl[i].onset = digit ? _inventory[_consonants[digit - 1]] : Segment();
+
+		if (i < n - 1)
+			syl[i].coda = Segment();
+	}
+	return n;
+}
+
+bool NameCodec::render(NameCode code, char *buffer, const Orthography *orthography) const {
+	Syllable syl[MAX_SYLLABLES];
+	int n = decode(code, syl);
+
+	*buffer = '\0';
+	if (n == 0)
+		return false;
+
+	Word word(syl, n);
+	if (orthography)
+		word.render(buffer, *orthography);
+	else
+		word.render(buffer);
+	return true;
+}
+
+const NameCodec &en_nameCodec() {
+	static const NameCodec codec(en_inventory());
+	return codec;
+}
@@ -0,0 +1,59 @@
+#ifndef __NAMECODE__
+#define __NAMECODE__
+
+#include <vector>
+
+#include "misc.h"
+#include "phonetics.h"
+#include "word.h"
+
+// a word's segment ids in 64 bits, 0 for no word
+typedef uint64 NameCode;
+
+// Packs the words the generators draw, open syllables followed by a closed
+// one, into a NameCode and back.
+//
+// Onsets and codas come from the consonant segments of the inventory or are
+// empty, nuclei from the vowel segments, so each slot is a digit of its own
+// radix; a word is the mixed radix number of its digits, offset by the
+// codes of all shorter words. Codes are dense and order words by length,
+// then by their segments, and encode() and decode() take a fixed number of
+// multiplications and divisions per segment.
+//
+// Two words have the same code exactly if they have the same segments, so
+// codes can be compared, hashed and deduplicated as integers. Different
+// segments can still be spelled alike; a code keeps the ids, not table
+// spellings of other languages, and renders with the inventory's.
+class NameCodec {
+
+	const SegmentInventory		&_inventory;
+	std::vector<int>			_digit;			// [id] within its class
+	std::vector<char>			_vowel;			// [id]
+	std::vector<int>			_consonants;	// [digit - 1] the id
+	std::vector<int>			_vowels;		// [digit]
+	uint64						_first[MAX_SYLLABLES + 2];		// [n] code of the first n syllable word
+	int							_maxSyllables;	// longest words that fit
+
+public:
+	NameCodec(const SegmentInventory &inventory);
+
+	// 0 if the word does not fit: a coda before the last syllable, a
+	// segment in the wrong slot or too many syllables
+	NameCode encode(const Syllable *syl, int numSyllables) const;
+
+	// syl must hold MAX_SYLLABLES; returns the number of syllables, 0 for
+	// codes that are no word
+	int decode(NameCode code, Syllable *syl) const;
+
+	// spells the word by the table or the orthography, buffer must hold
+	// MAX_NAME_LEN; false and an empty buffer for codes that are no word
+	bool render(NameCode code, char *buffer, const Orthography *orthography = 0) const;
+
+	int maxSyllables() const {
+		return _maxSyllables;
+	}
+};
+
+const NameCodec &en_nameCodec();
+
+#endif
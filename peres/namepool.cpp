@@ -0,0 +1,166 @@
+#include <string.h>
+
+#include <chrono>
+
+#include "namepool.h"
+#include "generator.h"
+
+NamePool::NamePool(int capacity, int lowWater, int highWater) :
+	_enqueuePos(0), _dequeuePos(0),
+	_pushed(0), _popped(0), _misses(0), _rejected(0), _refills(0),
+	_inFlight(0), _running(false) {
+
+	uint64 size = 2;
+	while (size < (uint64)capacity)
+		size <<= 1;
+
+	_mask = size - 1;
+	_cells = new Cell[size];
+	for (uint64 i = 0; i < size; i++)
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+	if (highWater <= 0 || highWater > (int)size)
+		highWater = (int)size;
+	if (lowWater < 0 || lowWater >= highWater)
+		lowWater = highWater / 2;
+
+	_lowWater = lowWater;
+	_highWater = highWater;
+}
+
+NamePool::~NamePool() {
+	stopProducers();
+	delete[] _cells;
+}
+
+bool NamePool::push(const char *name) {
+	Cell *cell;
+	uint64 pos = _enqueuePos.load(std::memory_order_relaxed);
+
+	for (;;) {
+		cell = &_cells[pos & _mask];
+		uint64 seq = cell->sequence.load(std::memory_order_acquire);
+		long long diff = (long long)(seq - pos);
+
+		if (diff == 0) {
+			if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = _enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	strncpy(cell->name, name, MAX_NAME_LEN - 1);
+	cell->name[MAX_NAME_LEN - 1] = '\0';
+	cell->sequence.store(pos + 1, std::memory_order_release);
+
+	_pushed.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool NamePool::pop(char *buffer) {
+	Cell *cell;
+	uint64 pos = _dequeuePos.load(std::memory_order_relaxed);
+
+	for (;;) {
+		cell = &_cells[pos & _mask];
+		uint64 seq = cell->sequence.load(std::memory_order_acquire);
+		long long diff = (long long)(seq - (pos + 1));
+
+		if (diff == 0) {
+			if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			_misses.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		} else {
+			pos = _dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	strcpy(buffer, cell->name);
+	cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+
+	_popped.fetch_add(1, std::memory_order_relaxed);
+
+	// only the pop crossing the watermark pays for waking the producers
+	if ((int)(_enqueuePos.load(std::memory_order_relaxed) - pos - 1) == _lowWater) {
+		_refills.fetch_add(1, std::memory_order_relaxed);
+		_wakeUp.notify_all();
+	}
+
+	return true;
+}
+
+int NamePool::occupancy() const {
+	uint64 tail = _dequeuePos.load(std::memory_order_relaxed);
+	uint64 head = _enqueuePos.load(std::memory_order_relaxed);
+
+	return (head > tail) ? (int)(head - tail) : 0;
+}
+
+void NamePool::getStats(NamePoolStats &stats) const {
+	stats.occupancy = occupancy();
+	stats.pushed = _pushed.load(std::memory_order_relaxed);
+	stats.popped = _popped.load(std::memory_order_relaxed);
+	stats.misses = _misses.load(std::memory_order_relaxed);
+	stats.rejected = _rejected.load(std::memory_order_relaxed);
+	stats.refills = _refills.load(std::memory_order_relaxed);
+}
+
+void NamePool::produce(uint32 seed) {
+	RandSeed openSeed(seed), closedSeed(seed + 1);
+	EnglishWordGenerator gen(openSeed, closedSeed);
+
+	char buffer[MAX_NAME_LEN];
+
+	while (_running.load(std::memory_order_relaxed)) {
+
+		// names other producers are still drawing count as pushed, so that
+		// producers passing the check together stop at the watermark; the
+		// reservation is taken before occupancy() is read, which can only
+		// count a finished one twice
+		int pending = _inFlight.fetch_add(1);
+		if (occupancy() + pending >= _highWater) {
+			_inFlight.fetch_sub(1);
+
+			// a pop crossing the low watermark wakes us up; the timeout only
+			// covers a notification racing with going to sleep
+			std::unique_lock<std::mutex> lock(_sleepLock);
+			do {
+				_wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+			} while (occupancy() > _lowWater && _running.load(std::memory_order_relaxed));
+			continue;
+		}
+
+		_rejected.fetch_add(gen.generateValid(buffer), std::memory_order_relaxed);
+
+		bool pushed;
+		while (!(pushed = push(buffer)) && _running.load(std::memory_order_relaxed))
+			std::this_thread::yield();
+		_inFlight.fetch_sub(1);
+		if (!pushed)
+			return;
+	}
+}
+
+void NamePool::startProducers(int numThreads, uint32 seed) {
+	if (_running.exchange(true))
+		return;
+
+	// every producer owns a pair of seeds and its own generators
+	for (int i = 0; i < numThreads; i++)
+		_producers.push_back(std::thread(&NamePool::produce, this, seed + 2 * i));
+}
+
+void NamePool::stopProducers() {
+	if (!_running.exchange(false))
+		return;
+
+	_wakeUp.notify_all();
+	for (size_t i = 0; i < _producers.size(); i++)
+		_producers[i].join();
+	_producers.clear();
+}
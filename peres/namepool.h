@@ -0,0 +1,82 @@
+#ifndef __NAMEPOOL__
+#define __NAMEPOOL__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "misc.h"
+#include "word.h"
+
+struct NamePoolStats {
+	int		occupancy;		// names ready to be popped
+	uint64	pushed;			// names published by producers
+	uint64	popped;			// names handed out to consumers
+	uint64	misses;			// pops that found the pool empty
+	uint64	rejected;		// candidates thrown away by Word::validate
+	uint64	refills;		// times the pool dropped under the low watermark
+};
+
+// Bounded multi-producer/multi-consumer ring of pre-rendered names.
+//
+// Every cell carries a sequence number telling whether it is ready to be
+// written or read at a given cursor position (Vyukov's bounded queue), so
+// both push() and pop() claim their cell with a single CAS and never block.
+// Producer threads run the EnglishWordGenerator pipeline, filling the ring
+// up to the high watermark and then sleeping until consumers drain it below
+// the low watermark.
+class NamePool {
+
+	struct Cell {
+		std::atomic<uint64>	sequence;
+		char				name[MAX_NAME_LEN];
+	};
+
+	Cell					*_cells;
+	uint64					_mask;
+	int						_lowWater;
+	int						_highWater;
+
+	alignas(64) std::atomic<uint64>	_enqueuePos;
+	alignas(64) std::atomic<uint64>	_dequeuePos;
+
+	alignas(64) std::atomic<uint64>	_pushed;
+	std::atomic<uint64>		_popped;
+	std::atomic<uint64>		_misses;
+	std::atomic<uint64>		_rejected;
+	std::atomic<uint64>		_refills;
+	std::atomic<int>		_inFlight;		// names producers are drawing
+
+	std::vector<std::thread>	_producers;
+	std::atomic<bool>		_running;
+	std::mutex				_sleepLock;
+	std::condition_variable	_wakeUp;
+
+	void produce(uint32 seed);
+
+	NamePool(const NamePool &);
+	NamePool& operator=(const NamePool &);
+
+public:
+	// capacity is rounded up to a power of two; the watermarks are clamped to it
+	NamePool(int capacity, int lowWater, int highWater);
+	~NamePool();
+
+	// both return false instead of waiting when the ring is full / empty
+	bool push(const char *name);
+	bool pop(char *buffer);
+
+	void startProducers(int numThreads, uint32 seed);
+	void stopProducers();
+
+	int capacity() const {
+		return (int)(_mask + 1);
+	}
+
+	int occupancy() const;
+	void getStats(NamePoolStats &stats) const;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <sstream>
+
+#include "orthography.h"
+
+Orthography::Orthography() : _numSegments(0), _numSymbols(1), _numLeft(1), _numRight(1) {
+	_leftClass.assign(1, 0);
+	_rightClass.assign(1, 0);
+	_spellingOf.assign(1, 0);
+	_text.assign(1, '\0');
+	_offset.assign(1, 0);
+	_length.assign(1, 0);
+}
+
+bool Orthography::fail(int line, const std::string &message) {
+	char prefix[32] = "";
+	if (line > 0)
+		sprintf(prefix, "line %d: ", line);
+	_error = prefix + message;
+	return false;
+}
+
+// '#' is the boundary, an empty context anything
+bool Orthography::parseContext(const std::string &text, const Phonotactics &rules, std::vector<char> &symbols) {
+	if (text.empty()) {
+		symbols.assign(_numSymbols, 1);
+		return true;
+	}
+
+	if (text == "#") {
+		symbols.assign(_numSymbols, 0);
+		symbols[boundary()] = 1;
+		return true;
+	}
+
+	if (!rules.itemSymbols(text, symbols))
+		return false;
+	symbols.push_back(0);
+	return true;
+}
+
+int Orthography::addSpelling(const std::string &text) {
+	_offset.push_back((unsigned short)_text.size());
+	_length.push_back((unsigned char)text.size());
+	_text.insert(_text.end(), text.begin(), text.end());
+	_text.push_back('\0');
+	return (int)_offset.size() - 1;
+}
+
+// partitions symbols by the rules whose context they satisfy
+static int classify(const std::vector<std::vector<char> > &contexts, int numSymbols, std::vector<unsigned char> &classOf, std::vector<int> &representative) {
+	std::map<std::vector<char>, int> classes;
+
+	classOf.resize(numSymbols);
+	representative.clear();
+	for (int s = 0; s < numSymbols; s++) {
+		std::vector<char> signature(contexts.size());
+		for (size_t r = 0; r < contexts.size(); r++)
+			signature[r] = contexts[r][s];
+
+		std::map<std::vector<char>, int>::iterator it = classes.find(signature);
+		if (it == classes.end()) {
+			it = classes.insert(std::make_pair(signature, (int)representative.size())).first;
+			representative.push_back(s);
+		}
+		classOf[s] = (unsigned char)it->second;
+	}
+
+	return (int)representative.size();
+}
+
+bool Orthography::compile(const char *text, const Phonotactics &rules) {
+	_numSegments = rules.numSegments();
+	_numSymbols = kNumSlots * _numSegments + 1;
+
+	std::vector<std::vector<char> > targets, lefts, rights;
+	std::vector<std::string> outputs;
+
+	std::istringstream in(text);
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(in, line)) {
+		lineNumber++;
+
+		// a lone '#' in a context is the boundary, not a comment
+		std::vector<std::string> words;
+		std::istringstream tokens(line);
+		std::string word;
+		while (tokens >> word) {
+			if (word[0] == '#' && !(word == "#" && !words.empty() && (words.back() == "/" || words.back() == "_")))
+				break;
+			words.push_back(word);
+		}
+
+		if (words.empty())
+			continue;
+		if (words[0] != "spell" || words.size() < 3)
+			return fail(lineNumber, "usage: spell ITEM TEXT [/ LEFT _ RIGHT]");
+
+		std::vector<char> target, left, right;
+		if (!rules.itemSymbols(words[1], target))
+			return fail(lineNumber, "bad item '" + words[1] + "'");
+		target.push_back(0);
+
+		std::string leftText, rightText;
+		if (words.size() > 3) {
+			if (words[3] != "/")
+				return fail(lineNumber, "expected '/' after the spelling");
+
+			size_t w = 4;
+			if (w < words.size() && words[w] != "_")
+				leftText = words[w++];
+			if (w >= words.size() || words[w] != "_")
+				return fail(lineNumber, "context needs '_' for the segment");
+			w++;
+			if (w < words.size())
+				rightText = words[w++];
+			if (w != words.size())
+				return fail(lineNumber, "trailing words after the context");
+		}
+
+		if (!parseContext(leftText, rules, left))
+			return fail(lineNumber, "bad item '" + leftText + "'");
+		if (!parseContext(rightText, rules, right))
+			return fail(lineNumber, "bad item '" + rightText + "'");
+
+		std::string output = words[2] == "-" ? "" : words[2];
+		if (output.size() > 255)
+			return fail(lineNumber, "spelling too long");
+
+		targets.push_back(target);
+		lefts.push_back(left);
+		rights.push_back(right);
+		outputs.push_back(output);
+	}
+
+	std::vector<int> leftRep, rightRep;
+	_numLeft = classify(lefts, _numSymbols, _leftClass, leftRep);
+	_numRight = classify(rights, _numSymbols, _rightClass, rightRep);
+
+	// spellings 0 .. numSegments - 1 are the table ones, rule outputs follow
+	_text.clear();
+	_offset.clear();
+	_length.clear();
+	for (int id = 0; id < _numSegments; id++) {
+		const char *spelling = rules.segment(id)._spelling;
+		addSpelling(spelling ? spelling : "");
+	}
+
+	std::vector<int> ruleSpelling(outputs.size());
+	for (size_t r = 0; r < outputs.size(); r++)
+		ruleSpelling[r] = addSpelling(outputs[r]);
+
+	if (_text.size() > 0xFFFF || _offset.size() > 0xFFFF)
+		return fail(0, "too many spellings");
+
+	_spellingOf.assign(_numSymbols * _numLeft * _numRight, 0);
+	for (int s = 0; s < _numSymbols; s++) {
+		int id = s < boundary() ? s % _numSegments : 0;
+
+		for (int l = 0; l < _numLeft; l++) {
+			for (int r = 0; r < _numRight; r++) {
+				int spelling = id;
+
+				for (size_t rule = 0; rule < outputs.size(); rule++) {
+					if (targets[rule][s] && lefts[rule][leftRep[l]] && rights[rule][rightRep[r]]) {
+						spelling = ruleSpelling[rule];
+						break;
+					}
+				}
+
+				_spellingOf[(s * _numLeft + l) * _numRight + r] = (unsigned short)spelling;
+			}
+		}
+	}
+
+	_error.clear();
+	return true;
+}
+
+bool Orthography::load(const char *path, const Phonotactics &rules) {
+	std::string text;
+	if (!readFile(path, text)) {
+		_error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	return compile(text.c_str(), rules);
+}
+
+int Orthography::render(const int *ids, const unsigned char *slots, int numSegs, char *buffer) const {
+	char *dst = buffer;
+	int left = boundary();
+	int current = numSegs > 0 ? symbol(slots[0], ids[0]) : boundary();
+
+	for (int i = 0; i < numSegs; i++) {
+		int right = i + 1 < numSegs ? symbol(slots[i + 1], ids[i + 1]) : boundary();
+		const char *text;
+		int length = spelling(left, current, right, text);
+
+		memcpy(dst, text, length);
+		dst += length;
+
+		left = current;
+		current = right;
+	}
+
+	*dst = '\0';
+	return (int)(dst - buffer);
+}
@@ -0,0 +1,92 @@
+#ifndef __ORTHOGRAPHY__
+#define __ORTHOGRAPHY__
+
+#include <string>
+#include <vector>
+
+#include "misc.h"
+#include "phonotactics.h"
+
+// Context sensitive spelling, compiled into one lookup table.
+//
+// Rules are tried in order, the first one matching a segment and its two
+// neighbours gives its spelling; segments no rule matches keep their table
+// spelling. One rule per line, '#' starting a comment:
+//
+//   spell ITEM TEXT [/ LEFT _ RIGHT]
+//
+// ITEM, LEFT and RIGHT are items of the Phonotactics rule language, '#'
+// standing for the word boundary and an empty side for anything. TEXT is
+// the new spelling, '-' for none.
+//
+// The neighbours only enter through the classes of symbols the context
+// items tell apart, so the table is indexed by (slot, id) of the segment
+// and the classes of its left and right neighbour, and renders a word in
+// one pass with a single lookup and copy per segment.
+class Orthography {
+
+	int							_numSegments;
+	int							_numSymbols;		// slot * id, plus the boundary
+
+	std::vector<unsigned char>	_leftClass;			// [symbol]
+	std::vector<unsigned char>	_rightClass;
+	int							_numLeft;
+	int							_numRight;
+
+	std::vector<unsigned short>	_spellingOf;		// [(symbol * _numLeft + left) * _numRight + right]
+	std::vector<char>			_text;				// all spellings, 0 terminated
+	std::vector<unsigned short>	_offset;			// [spelling]
+	std::vector<unsigned char>	_length;
+
+	std::string					_error;
+
+	bool fail(int line, const std::string &message);
+	bool parseContext(const std::string &text, const Phonotactics &rules, std::vector<char> &symbols);
+	int addSpelling(const std::string &text);
+
+public:
+	Orthography();
+
+	bool compile(const char *text, const Phonotactics &rules);
+	bool load(const char *path, const Phonotactics &rules);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	// the symbol standing for the word boundary in spelling()
+	int boundary() const {
+		return _numSymbols - 1;
+	}
+
+	int symbol(int slot, int id) const {
+		return slot * _numSegments + id;
+	}
+
+	// spelling of symbol between two neighbour symbols, returns its length
+	int spelling(int left, int symbol, int right, const char *&text) const {
+		return spellingAfter(_leftClass[left], symbol, right, text);
+	}
+
+	// the left neighbours a spelling can tell apart, for callers tracking
+	// only those
+	int numLeftClasses() const {
+		return _numLeft;
+	}
+
+	int leftClass(int symbol) const {
+		return _leftClass[symbol];
+	}
+
+	// same with the left neighbour given by its class
+	int spellingAfter(int leftClass, int symbol, int right, const char *&text) const {
+		int s = _spellingOf[(symbol * _numLeft + leftClass) * _numRight + _rightClass[right]];
+		text = &_text[_offset[s]];
+		return _length[s];
+	}
+
+	// renders segment ids and slots into buffer, returns the length
+	int render(const int *ids, const unsigned char *slots, int numSegs, char *buffer) const;
+};
+
+#endif
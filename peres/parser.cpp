@@ -0,0 +1,371 @@
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "parser.h"
+
+// what the rules need to know of the segments so far; the parts a search
+// does not check stay 0
+struct NameParser::Path {
+	int		state;				// DFA state
+	int		last;				// content class of the last segment, see norepeat
+	uint64	counts[3];			// the maxcount counters, see Phonotactics::accepts()
+
+	bool operator==(const Path &path) const {
+		return state == path.state && last == path.last && counts[0] == path.counts[0] &&
+			counts[1] == path.counts[1] && counts[2] == path.counts[2];
+	}
+};
+
+// a syllable boundary reached at some character, or a whole split
+struct NameParser::Boundary {
+	double			logProb;		// of the syllables so far, without the count
+	Path			path;
+	int				syllables;
+	int				prev;			// boundary before the last syllable, -1 at the start
+	int				next;			// next boundary at the same character
+	unsigned short	onset, nucleus, coda;	// of the last syllable
+};
+
+// matches of a slot starting at one character; spellings are a few letters
+// shared by a handful of segments each
+#define MAX_MATCHES		16
+
+NameParser::NameParser(const CountDistribution &syllableCounts) : _rules(en_phonotactics()) {
+	const SegmentInventory &inventory = en_inventory();
+
+	_nullId = 0;
+	while (_nullId < inventory.size && inventory[_nullId]._numItems > 0)
+		_nullId++;
+
+	// every segment the generators know, whatever its weight, so that names
+	// with rare or unused segments still split
+	SegmentDistribution dists[kNumSlots];
+	en_setupOnsets(dists[kSlotOnset]);
+	en_setupNuclei(dists[kSlotNucleus]);
+	en_setupCodas(dists[kSlotCoda]);
+
+	_next.assign(26, 0);
+	for (int slot = 0; slot < kNumSlots; slot++)
+		_maxSpelling[slot] = 0;
+	std::vector<std::pair<uint32, unsigned short> > ends;	// (node * kNumSlots + slot, id)
+	for (int slot = 0; slot < kNumSlots; slot++) {
+		for (int i = 0; i < dists[slot].size(); i++) {
+			const Segment &seg = dists[slot].item(i);
+			if (seg._numItems == 0)
+				continue;
+			_maxSpelling[slot] = std::max(_maxSpelling[slot], (int)strlen(seg._spelling));
+			ends.push_back(std::make_pair((uint32)(addSpelling(seg._spelling) * kNumSlots + slot), (unsigned short)seg._id));
+		}
+	}
+
+	_maxSyllable = _maxSpelling[kSlotOnset] + _maxSpelling[kSlotNucleus] + _maxSpelling[kSlotCoda];
+
+	std::sort(ends.begin(), ends.end());
+	ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+	Span empty = { 0, 0 };
+	_ends.assign(_next.size() / 26 * kNumSlots, empty);
+	for (size_t i = 0; i < ends.size(); i++) {
+		Span &span = _ends[ends[i].first];
+		if (span.count == 0)
+			span.first = (uint32)_ids.size();
+		span.count++;
+		_ids.push_back(ends[i].second);
+	}
+
+	const EnglishSyllableOdds &odds = EnglishSyllableOdds::get();
+	for (int position = 0; position < kNumPositions; position++) {
+		for (int slot = 0; slot < kNumSlots; slot++) {
+			_logProb[position][slot].resize(inventory.size);
+			for (int id = 0; id < inventory.size; id++) {
+				double p = odds.segmentProbability(position, slot, id);
+				_logProb[position][slot][id] = p > 0 ? log(p) : -HUGE_VAL;
+			}
+		}
+		_logMass[position] = log(odds.mass(position));
+	}
+
+	for (int n = 0; n <= MAX_SYLLABLES; n++)
+		_logCount[n] = -HUGE_VAL;
+	for (int i = 0; i < syllableCounts.size(); i++) {
+		int n = syllableCounts.item(i);
+		if (n >= 1 && n <= MAX_SYLLABLES && syllableCounts.frequency(i) > 0)
+			_logCount[n] = log((double)syllableCounts.frequency(i) / syllableCounts.cumFreq());
+	}
+}
+
+// the trie node of spelling, added if need be
+int NameParser::addSpelling(const char *spelling) {
+	int node = 0;
+	for (const char *c = spelling; *c; c++) {
+		assert(*c >= 'a' && *c <= 'z');
+		int child = _next[node * 26 + (*c - 'a')];
+		if (!child) {
+			child = (int)(_next.size() / 26);
+			_next[node * 26 + (*c - 'a')] = (unsigned short)child;
+			_next.resize(_next.size() + 26, 0);
+		}
+		node = child;
+	}
+	return node;
+}
+
+// the segments of the slot spelled from name[from] on, the empty onset or
+// coda first
+int NameParser::match(const char *name, int length, int from, int slot, Match *out) const {
+	int n = 0;
+	if (slot != kSlotNucleus) {
+		out[n].end = from;
+		out[n++].id = _nullId;
+	}
+
+	int node = 0;
+	for (int c = from; c < length; c++) {
+		node = _next[node * 26 + (name[c] - 'a')];
+		if (!node)
+			break;
+
+		const Span &span = _ends[node * kNumSlots + slot];
+		for (uint32 k = 0; k < span.count && n < MAX_MATCHES; k++) {
+			out[n].end = c + 1;
+			out[n++].id = _ids[span.first + k];
+		}
+	}
+	return n;
+}
+
+// appends a segment to path, false if the rules checked reject it
+bool NameParser::advance(Path &path, int rules, int slot, int id) const {
+	if (rules == kRulesNone || id == _nullId)
+		return true;
+
+	if ((path.state = _rules.step(path.state, slot, id)) == Phonotactics::kDeadState)
+		return false;
+
+	if (_rules.noRepeat()) {
+		int content = _rules.contentClasses()[id];
+		if (content == path.last)
+			return false;
+		path.last = content;
+	}
+
+	if (rules == kRulesAll) {
+		const uint64 *inc = _rules.countIncrements() + id * 3;
+		uint64 overflow = 0;
+		for (int w = 0; w < 3; w++) {
+			path.counts[w] += inc[w];
+			overflow |= path.counts[w] & 0x8888888888888888ULL;
+		}
+		if (overflow)
+			return false;
+	}
+	return true;
+}
+
+// Viterbi over the syllable boundaries of a lower case name; returns the
+// state holding the winner, the last one, or -1 if the name does not split
+int NameParser::search(const char *name, int length, int rules, Boundary *states, int maxStates) const {
+	const int winnerState = maxStates - 1;
+
+	// the nuclei at a character are the same for all boundaries, they are
+	// matched once when first needed
+	Match onsets[MAX_MATCHES], nuclei[MAX_NAME_LEN * MAX_MATCHES], codas[MAX_MATCHES];
+	int numNuclei[MAX_NAME_LEN], heads[MAX_NAME_LEN];
+	for (int p = 0; p < length; p++) {
+		numNuclei[p] = -1;
+		heads[p] = -1;
+	}
+
+	Boundary &start = states[0];
+	memset(&start, 0, sizeof(start));
+	start.path.state = rules != kRulesNone ? _rules.startState() : 0;
+	start.path.last = -1;
+	if (rules == kRulesAll)
+		memcpy(start.path.counts, _rules.countBias(), sizeof(start.path.counts));
+	start.prev = start.next = -1;
+	heads[0] = 0;
+	int numStates = 1;
+	bool found = false;
+
+	// the last segment only matters to norepeat where a nucleus spelled the
+	// same may follow; elsewhere it is dropped so that more paths merge
+	const int *content = rules != kRulesNone && _rules.noRepeat() ? _rules.contentClasses() : 0;
+
+	// boundaries only lead to later characters, so each is complete before
+	// it is expanded
+	for (int p = 0; p < length; p++) {
+		int numOnsets = heads[p] >= 0 ? match(name, length, p, kSlotOnset, onsets) : 0;
+
+		for (int b = heads[p]; b >= 0; b = states[b].next) {
+			const Boundary &from = states[b];
+			int i = from.syllables;
+			bool open = i + 1 < MAX_SYLLABLES;
+			bool closed = length - p <= _maxSyllable;
+
+			for (const Match *o = onsets; o < onsets + numOnsets; o++) {
+				int onset = o->id;
+				Path afterOnset = from.path;
+				if (o->end >= length || !advance(afterOnset, rules, kSlotOnset, onset))
+					continue;
+
+				const Match *first = nuclei + o->end * MAX_MATCHES;
+				if (numNuclei[o->end] < 0)
+					numNuclei[o->end] = match(name, length, o->end, kSlotNucleus, nuclei + o->end * MAX_MATCHES);
+				for (const Match *v = first; v < first + numNuclei[o->end]; v++) {
+					int nucleus = v->id;
+					Path path = afterOnset;
+					if (!advance(path, rules, kSlotNucleus, nucleus))
+						continue;
+					int end = v->end;
+
+					// another syllable follows, which needs a character
+					if (open && end < length) {
+						int position = i == 0 ? kPositionInitial : kPositionMedial;
+						double lp = from.logProb + _logProb[position][kSlotOnset][onset] +
+							_logProb[position][kSlotNucleus][nucleus] - _logMass[position];
+
+						Path merged = path;
+						if (content) {
+							if (numNuclei[end] < 0)
+								numNuclei[end] = match(name, length, end, kSlotNucleus, nuclei + end * MAX_MATCHES);
+							merged.last = -1;
+							for (int k = 0; k < numNuclei[end]; k++)
+								if (content[nuclei[end * MAX_MATCHES + k].id] == path.last)
+									merged.last = path.last;
+						}
+
+						int k = heads[end];
+						while (k >= 0 && (states[k].syllables != i + 1 || !(states[k].path == merged)))
+							k = states[k].next;
+						if (k < 0) {
+							if (numStates >= winnerState)
+								continue;
+							k = numStates++;
+							states[k].syllables = i + 1;
+							states[k].path = merged;
+							states[k].logProb = -HUGE_VAL;
+							states[k].next = heads[end];
+							heads[end] = k;
+						}
+						if (lp > states[k].logProb || states[k].logProb == -HUGE_VAL) {
+							states[k].logProb = lp;
+							states[k].prev = b;
+							states[k].onset = (unsigned short)onset;
+							states[k].nucleus = (unsigned short)nucleus;
+							states[k].coda = (unsigned short)_nullId;
+						}
+					}
+
+					if (!closed || length - end > _maxSpelling[kSlotCoda])
+						continue;
+
+					int position = i == 0 ? kPositionOnly : kPositionFinal;
+					double lp = from.logProb + _logProb[position][kSlotOnset][onset] +
+						_logProb[position][kSlotNucleus][nucleus] - _logMass[position];
+
+					int numCodas = match(name, length, end, kSlotCoda, codas);
+					for (int c = 0; c < numCodas; c++) {
+						int coda = codas[c].id;
+						Path last = path;
+						if (codas[c].end != length || !advance(last, rules, kSlotCoda, coda))
+							continue;
+						double lpCoda = lp + _logProb[position][kSlotCoda][coda];
+
+						// syllable counts the generator draws first, then the
+						// most probable
+						Boundary &winner = states[winnerState];
+						bool drawn = _logCount[i + 1] > -HUGE_VAL;
+						bool winnerDrawn = found && _logCount[winner.syllables] > -HUGE_VAL;
+						if (found && (drawn < winnerDrawn || (drawn == winnerDrawn && !(lpCoda > winner.logProb))))
+							continue;
+
+						found = true;
+						winner.logProb = lpCoda;
+						winner.syllables = i + 1;
+						winner.prev = b;
+						winner.onset = (unsigned short)onset;
+						winner.nucleus = (unsigned short)nucleus;
+						winner.coda = (unsigned short)coda;
+					}
+				}
+			}
+		}
+	}
+
+	return found ? winnerState : -1;
+}
+
+// Word::validate() of the split ending in states[best], without building
+// the word
+bool NameParser::accepts(const Boundary *states, int best) const {
+	int ids[MAX_SEGS];
+	unsigned char slots[MAX_SEGS];
+	int n = 0;
+
+	// backwards from the last segment
+	for (int k = best; k > 0; k = states[k].prev) {
+		const unsigned short segs[kNumSlots] = { states[k].onset, states[k].nucleus, states[k].coda };
+		for (int slot = kNumSlots - 1; slot >= 0; slot--) {
+			if (segs[slot] != _nullId) {
+				ids[n] = segs[slot];
+				slots[n++] = (unsigned char)slot;
+			}
+		}
+	}
+	std::reverse(ids, ids + n);
+	std::reverse(slots, slots + n);
+	return _rules.accepts(ids, slots, n);
+}
+
+bool NameParser::parse(const char *name, ParsedName &result) const {
+	result.numSyllables = 0;
+	result.valid = false;
+	result.logProb = -HUGE_VAL;
+
+	char text[MAX_NAME_LEN];
+	int length = 0;
+	for (; name[length]; length++) {
+		char c = name[length];
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		if (length >= MAX_NAME_LEN - 1 || c < 'a' || c > 'z')
+			return false;
+		text[length] = c;
+	}
+	if (length == 0)
+		return false;
+
+	// the automaton and norepeat first; the maxcount counters split the
+	// paths much further, so they are only tracked if the winner breaks them
+	Boundary stack[PARSER_MAX_STATES];
+	std::vector<Boundary> counted;
+	Boundary *states = stack;
+
+	int best = search(text, length, kRulesAutomaton, states, PARSER_MAX_STATES);
+	bool valid = best >= 0 && accepts(states, best);
+	if (best >= 0 && !valid) {
+		counted.resize(PARSER_MAX_COUNTED);
+		states = &counted[0];
+		best = search(text, length, kRulesAll, states, PARSER_MAX_COUNTED);
+		valid = best >= 0;
+	}
+	if (best < 0)
+		best = search(text, length, kRulesNone, states, PARSER_MAX_STATES);
+	if (best < 0)
+		return false;
+
+	const SegmentInventory &inventory = en_inventory();
+	int n = states[best].syllables;
+	for (int i = n - 1, k = best; i >= 0; k = states[k].prev, i--) {
+		Syllable &syl = result.syllables[i];
+		syl.onset = inventory[states[k].onset];
+		syl.nucleus = inventory[states[k].nucleus];
+		syl.coda = inventory[states[k].coda];
+	}
+
+	result.numSyllables = n;
+	result.logProb = states[best].logProb + _logCount[n];
+	result.valid = valid;
+	return true;
+}
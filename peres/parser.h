@@ -0,0 +1,90 @@
+#ifndef __PARSER__
+#define __PARSER__
+
+#include <vector>
+
+#include "misc.h"
+#include "generator.h"
+
+// boundaries the parse of one name keeps, more are dropped; the pass
+// tracking the maxcount counters needs far more
+#define PARSER_MAX_STATES		256
+#define PARSER_MAX_COUNTED		0x4000
+
+struct ParsedName {
+	Syllable	syllables[MAX_SYLLABLES];
+	int			numSyllables;		// 0 if the name does not split into segments
+	bool		valid;				// Word::validate() of the syllables
+	double		logProb;			// natural log of the chance to draw them, see below
+};
+
+// Splits a name back into the syllables EnglishWordGenerator draws, for
+// names that did not come from it: legacy catalogs, player renames.
+//
+// A trie over the table spellings of all segments finds the candidates at
+// each character; a Viterbi pass over syllable boundaries keeps, for every
+// (syllable count, rule state) reached at a character, the most probable
+// way to get there. The winner is the most probable split the rules
+// accept, scored like EnglishWordGenerator::probability(): the chance of
+// the syllable count times that of each syllable in its position. Only if
+// there is none the best split regardless of the rules is returned, marked
+// invalid.
+//
+// The rule state holds what the DFA and norepeat need. The maxcount
+// counters would keep far more paths apart, so they join it in a second
+// pass only when the winner of the first breaks a maxcount rule.
+//
+// Names are matched case insensitively against the segment table; names
+// rendered through an Orthography do not parse in general. logProb is
+// -HUGE_VAL for splits the generator never draws, such as syllable counts
+// outside the distribution.
+//
+// Parsing only reads the tables, one parser serves any number of threads.
+class NameParser {
+
+	struct Span {
+		uint32	first;
+		uint32	count;
+	};
+
+	// a segment spelled from some character on
+	struct Match {
+		int		end;
+		int		id;
+	};
+
+	struct Path;
+	struct Boundary;
+
+	// what search() holds against the rules
+	enum Rules {
+		kRulesNone,
+		kRulesAutomaton,			// forbid, limit and norepeat
+		kRulesAll
+	};
+
+	std::vector<unsigned short>	_next;			// [node * 26 + letter], 0 for none
+	std::vector<Span>			_ends;			// [node * kNumSlots + slot] into _ids
+	std::vector<unsigned short>	_ids;
+	std::vector<double>			_logProb[kNumPositions][kNumSlots];	// [position][slot][id]
+	double						_logMass[kNumPositions];
+	double						_logCount[MAX_SYLLABLES + 1];
+	int							_maxSpelling[kNumSlots];
+	int							_maxSyllable;		// characters
+	int							_nullId;			// the empty onset and coda
+	const Phonotactics			&_rules;
+
+	int addSpelling(const char *spelling);
+	int match(const char *name, int length, int from, int slot, Match *out) const;
+	bool advance(Path &path, int rules, int slot, int id) const;
+	int search(const char *name, int length, int rules, Boundary *states, int maxStates) const;
+	bool accepts(const Boundary *states, int best) const;
+
+public:
+	NameParser(const CountDistribution &syllableCounts);
+
+	// false if name does not split into segments at all
+	bool parse(const char *name, ParsedName &result) const;
+};
+
+#endif
@@ -61,26 +61,27 @@ struct Segment {
 	Phoneme set[MAX_PHONEMES_PER_SEGMENT];
 	int _numItems;
 	const char *_spelling;
+	int _id;			// index in the phonology's SegmentInventory
 
-	Segment() : _numItems(0) {
+	Segment() : _numItems(0), _id(0) {
 		_spelling = "";
 		set[0]._id = 0;
 	}
 
-	Segment(const char spelling[], const Phoneme &p0) {
+	Segment(const char spelling[], const Phoneme &p0) : _id(0) {
 		_numItems = 1;
 		set[0] = p0;
 		_spelling = spelling;
 	}
 
-	Segment(const char spelling[], Phoneme p0, Phoneme p1) {
+	Segment(const char spelling[], Phoneme p0, Phoneme p1) : _id(0) {
 		_numItems = 2;
 		set[0] = p0;
 		set[1] = p1;
 		_spelling = spelling;
 	}
 
-	Segment(const char spelling[], Phoneme p0, Phoneme p1, Phoneme p2) {
+	Segment(const char spelling[], Phoneme p0, Phoneme p1, Phoneme p2) : _id(0) {
 		_numItems = 3;
 		set[0] = p0;
 		set[1] = p1;
@@ -106,6 +107,7 @@ struct Segment {
 		set[1] = seg.set[1];
 		set[2] = seg.set[2];
 		_spelling = seg._spelling;
+		_id = seg._id;
 		return *this;
 	}
 
@@ -140,6 +142,25 @@ struct Segment {
 	}
 };
 
+// every segment a phonology draws from, so that words can be handled as
+// sequences of small integers
+struct SegmentInventory {
+	const Segment * const	*segments;
+	int						size;
+
+	const Segment &operator[](int id) const {
+		return *segments[id];
+	}
+};
+
+// where a segment sits in its syllable
+enum SegmentSlot {
+	kSlotOnset,
+	kSlotNucleus,
+	kSlotCoda,
+	kNumSlots
+};
+
 struct Syllable {
 	Segment onset;
 	Segment nucleus;
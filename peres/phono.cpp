@@ -1,273 +1,751 @@
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-
+#include <string.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include "tactics.h"
 #include "en_phonology.h"
 #include "misc.h"
+#include "generator.h"
+#include "constrained.h"
+#include "batch.h"
+#include "similarity.h"
+#include "analyzer.h"
+#include "orthography.h"
+#include "catalog.h"
+#include "entitynames.h"
+#include "enumerate.h"
+#include "syllabary.h"
+#include "grammar.h"
+#include "parser.h"
+#include "mixture.h"
+#include "family.h"
+#include "model.h"
+#include "namecode.h"
+#include "shmpool.h"
+#include "namepool.h"
 
 
 #define ARRAYSIZE(a) (sizeof(a)/sizeof((a[0])))
 
-typedef Distribution<Segment> SegmentDistribution;
+RandSeed seed0(0);
+RandSeed seed1(1);
+SobolSeed quasiSeed(0);
+
+// lets -q put the quasi-random stream under the global generator
+class SeedSwitch : public Seed {
+	Seed *_seed;
+public:
+	SeedSwitch(Seed &seed) : _seed(&seed) {
+	}
+	void select(Seed &seed) {
+		_seed = &seed;
+	}
+	uint32 getBits(uint32 num) {
+		return _seed->getBits(num);
+	}
+	void beginSample() {
+		_seed->beginSample();
+	}
+	bool quasiRandom() const {
+		return _seed->quasiRandom();
+	}
+};
 
-void en_setupOnsets(SegmentDistribution &dist);
-void en_setupNuclei(SegmentDistribution &dist);
-void en_setupCodas(SegmentDistribution &dist);
+SeedSwitch openSeed(seed0);
+SeedSwitch closedSeed(seed1);
 
+EnglishWordGenerator wordGen(openSeed, closedSeed);
 
+bool generateWord() {
 
-class EnglishSyllableGenerator : public SeededGenerator {
+	char buffer[MAX_NAME_LEN];
+	bool r = false;
 
-protected:
-	SegmentDistribution		codas;
-	SegmentDistribution		onsets;
-	SegmentDistribution		nuclei;
+	if (wordGen.generate(buffer)) {
+		printf("%s\n", buffer);
+		r = true;
+	} else {
+		printf("%s -> REJECTED\n", buffer);
+	}
 
-	// enforce 's'C1VC2 rule where V is a short vowel and C1/C2 must be different
-	bool rule0(const Syllable &syllable) const {
-		if (!syllable.hasOnset() || !syllable.hasCoda())
-			return true;
+	return r;
+}
 
-		Phoneme s = syllable.onset.first();
-		if (!s.hasProps( FRICATIVE | ALVEOLAR | VOICELESS ))
-			return true;
+// "count:weight,count:weight,..." as given to -k
+bool parseSyllableCounts(const char *text, CountDistribution &counts) {
+	while (*text) {
+		int n, weight, used;
+		if (sscanf(text, "%d:%d%n", &n, &weight, &used) != 2)
+			return false;
+		if (n < 0 || n > 255)
+			return false;
+		counts.addItem((unsigned char)n, weight);
+		text += used;
+		if (*text == ',')
+			text++;
+	}
+	return counts.size() > 0;
+}
 
-		Phoneme c1 = syllable.onset.last();
-		Phoneme c2 = syllable.coda.first();
+// -p prefix, -l min[:max] rendered length, -s syllables
+bool generateConstrained(const NameConstraints &constraints, int count) {
 
-		if (c1 != c2)
-			return true;
+	ConstrainedGenerator gen(constraints, wordGen.orthography());
+	gen.setBlocklist(wordGen.blocklist());
+	char buffer[MAX_NAME_LEN];
 
-		return !syllable.nucleus.isShortVowel();
+	for (int i = 0; i < count; i++) {
+		if (!gen.generate(buffer, seed0)) {
+			fprintf(stderr, "no word satisfies the constraints\n");
+			return false;
+		}
+		printf("%s\n", buffer);
 	}
 
-	bool validateSyllable(const Syllable &syllable) const {
-		return rule0(syllable);
+	return true;
+}
+
+// -b: validate candidates a block at a time, prints only the survivors
+void generateBatched(int count) {
+
+	BatchGenerator gen(wordGen);
+	static char names[BATCH_LANES * MAX_NAME_LEN];
+
+	while (count > 0) {
+		int n = gen.generateBlock(names);
+		for (int i = 0; i < n && i < count; i++)
+			printf("%s\n", names + i * MAX_NAME_LEN);
+		count -= n;
 	}
+}
 
-	virtual void genSyllable(Syllable &s) = 0;
+// -d: skips names within the given edit distance of one printed before
+void generateDistinct(int maxDistance, int count) {
 
-public:
-	EnglishSyllableGenerator(Seed &seed) : SeededGenerator(seed) {
-		en_setupCodas(codas);
-		en_setupOnsets(onsets);
-		en_setupNuclei(nuclei);
+	SimilarityFilter filter(maxDistance);
+	char buffer[MAX_NAME_LEN];
+
+	while (filter.size() < count) {
+		if (wordGen.generate(buffer) && filter.insert(buffer))
+			printf("%s\n", buffer);
 	}
+}
 
-};
+// -c: writes count valid names with all columns to a catalog file
+bool writeCatalog(const char *path, int count) {
 
-class EnglishOpenSyllableGenerator : public EnglishSyllableGenerator {
-public:
-	EnglishOpenSyllableGenerator(Seed &seed) : EnglishSyllableGenerator(seed) {
+	CatalogWriter catalog(kColumnSegments | kColumnStarts | kColumnProbability);
+	const Orthography *orthography = wordGen.orthography();
+	const Blocklist *blocklist = wordGen.blocklist();
+	Syllable syl[MAX_SYLLABLES];
+	char buffer[MAX_NAME_LEN];
+
+	// -m draws from mixed tables, whose odds are not the English ones
+	EnglishSyllableOdds odds(wordGen.tables());
+
+	while ((int)catalog.numNames() < count) {
+		int n = wordGen.drawSyllables(syl);
+		Word word(syl, n);
+		if (!word.validate(wordGen.tables().rules()))
+			continue;
+
+		if (orthography)
+			word.render(buffer, *orthography);
+		else
+			word.render(buffer);
+		if (blocklist && blocklist->contains(buffer))
+			continue;
+
+		catalog.add(buffer, word, orthography, wordGen.probability(syl, n, odds));
 	}
-	virtual void genSyllable(Syllable& s) {
-		do {
-			s.onset = onsets.getItem(_seed.getBits(onsets.cumFreq()));
-			s.nucleus = nuclei.getItem(_seed.getBits(nuclei.cumFreq()));
-		} while (!validateSyllable(s));
+
+	if (!catalog.write(path)) {
+		fprintf(stderr, "%s\n", catalog.error().c_str());
+		return false;
 	}
-};
+	return true;
+}
 
-class EnglishClosedSyllableGenerator : public EnglishSyllableGenerator {
-public:
-	EnglishClosedSyllableGenerator(Seed &seed) : EnglishSyllableGenerator(seed) {
+// -e seed -c: names entities 0 .. count-1 of a galaxy into a catalog
+// indexed by entity id
+bool writeEntityCatalog(const char *path, uint64 galaxySeed, int count) {
+
+	CatalogWriter catalog(kColumnEntityIds);
+	static uint64 ids[1024];
+	static char names[1024 * MAX_NAME_LEN];
+
+	for (int base = 0; base < count; base += 1024) {
+		int n = count - base < 1024 ? count - base : 1024;
+		for (int i = 0; i < n; i++)
+			ids[i] = (uint64)(base + i);
+
+		namesFor(galaxySeed, ids, n, names);
+		for (int i = 0; i < n; i++)
+			catalog.add(ids[i], names + i * MAX_NAME_LEN);
 	}
-	virtual void genSyllable(Syllable& s) {
-		do {
-			s.onset = onsets.getItem(_seed.getBits(onsets.cumFreq()));
-			s.nucleus = nuclei.getItem(_seed.getBits(nuclei.cumFreq()));
-			s.coda = codas.getItem(_seed.getBits(codas.cumFreq()));
-		} while (!validateSyllable(s));
 
-		return;
+	if (!catalog.write(path)) {
+		fprintf(stderr, "%s\n", catalog.error().c_str());
+		return false;
 	}
-};
+	return true;
+}
 
-enum type {
-	kNone,
-	kVowel,
-	kConsonant
-} ;
+// -i: the NameCodes of the first count entities, -e galaxy seed, and their names
+void printEntityCodes(uint64 galaxySeed, int count) {
+	char name[MAX_NAME_LEN];
+	for (int i = 0; i < count; i++) {
+		NameCode code = codeFor(galaxySeed, (uint64)i);
+		en_nameCodec().render(code, name);
+		printf("%016llx\t%s\n", (unsigned long long)code, name);
+	}
+}
 
-bool isVowel(char c) {
-	return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+// ring size and names a consumer takes per output batch in -N
+#define POOL_CAPACITY	4096
+#define POOL_BATCH		256
+
+// -N: consumers threads popping count names from a NamePool that -j
+// producer threads keep filled, as a server handing out names would
+void generatePooled(int numConsumers, int numProducers, int count) {
+	NamePool pool(POOL_CAPACITY, POOL_CAPACITY / 4, POOL_CAPACITY);
+	pool.startProducers(numProducers > 0 ? numProducers : 2, 0);
+
+	std::atomic<int> remaining(count);
+	std::mutex outLock;
+	std::vector<std::thread> consumers;
+	for (int t = 0; t < numConsumers; t++) {
+		consumers.push_back(std::thread([&]() {
+			std::string out;
+			char buffer[MAX_NAME_LEN];
+			while (remaining.fetch_sub(1) > 0) {
+				while (!pool.pop(buffer))
+					std::this_thread::yield();
+				out += buffer;
+				out += '\n';
+				if (out.size() >= POOL_BATCH * 8) {
+					std::lock_guard<std::mutex> guard(outLock);
+					fwrite(out.data(), 1, out.size(), stdout);
+					out.clear();
+				}
+			}
+			std::lock_guard<std::mutex> guard(outLock);
+			fwrite(out.data(), 1, out.size(), stdout);
+		}));
+	}
+	for (size_t t = 0; t < consumers.size(); t++)
+		consumers[t].join();
+	pool.stopProducers();
+
+	NamePoolStats stats;
+	pool.getStats(stats);
+	fprintf(stderr, "%llu pushed, %llu popped, %llu misses, %llu rejected, %llu refills\n",
+		stats.pushed, stats.popped, stats.misses, stats.rejected, stats.refills);
 }
 
-bool isConsonant(char c) {
-	return !isVowel(c);
+// refill batch and pause of -P
+#define POOL_REFILL		4096
+#define POOL_PAUSE_MS	2
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+	stopRequested = 1;
 }
 
-type getType(char c) {
-	if (c == 0) return kNone;
-	return isVowel(c) ? kVowel : kConsonant;
+// -P: creates or opens the shared pool of capacity names, -e galaxy seed, and
+// keeps it full until interrupted or out of names
+bool refillSharedPool(const char *name, int capacity, uint64 galaxySeed) {
+	SharedNamePool pool;
+	if (!pool.create(name, capacity, galaxySeed) || !pool.startRefilling()) {
+		fprintf(stderr, "%s\n", pool.error().c_str());
+		return false;
+	}
+
+	signal(SIGINT, requestStop);
+	signal(SIGTERM, requestStop);
+	while (!stopRequested && !pool.exhausted()) {
+		if (pool.refill(POOL_REFILL) == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(POOL_PAUSE_MS));
+	}
+
+	SharedNamePoolStats stats;
+	pool.getStats(stats);
+	fprintf(stderr, "%llu published, %llu claimed, %llu misses, %llu duplicates skipped\n",
+		stats.published, stats.claimed, stats.misses, stats.duplicates);
+	if (pool.exhausted()) {
+		fprintf(stderr, "%s has issued all of its %llu names\n", name, stats.maxIssued);
+		return false;
+	}
+	return true;
 }
 
-#define MAX_SEGS	10
-extern Phoneme phonemes[];
+// -C: count names claimed from the shared pool, waiting while it is empty
+bool claimSharedNames(const char *name, int count) {
+	SharedNamePool pool;
+	if (!pool.open(name)) {
+		fprintf(stderr, "%s\n", pool.error().c_str());
+		return false;
+	}
 
-class Word {
-	Segment	segs[MAX_SEGS];
-	int numSegs;
+	char buffer[MAX_NAME_LEN];
+	for (int i = 0; i < count; i++) {
+		while (!pool.claim(buffer))
+			std::this_thread::sleep_for(std::chrono::milliseconds(POOL_PAUSE_MS));
+		puts(buffer);
+	}
+	return true;
+}
 
-public:
-	Word(Syllable *syllables, int numSyllables) : numSegs(0) {
-		for (int i = 0; i < numSyllables; i++) {
-			if (syllables[i].hasOnset()) {
-				segs[numSegs++] = syllables[i].onset;
-			}
+// -y: names spliced from a tpnames corpus, the i-th from seed + i
+bool generateSpliced(const char *path, long long seed, int count) {
 
-			segs[numSegs++] = syllables[i].nucleus;
+	Syllabary syllabary;
+	if (!syllabary.load(path)) {
+		fprintf(stderr, "%s\n", syllabary.error().c_str());
+		return false;
+	}
 
-			if (syllables[i].hasCoda()) {
-				segs[numSegs++] = syllables[i].coda;
-			}
-		}
+	std::vector<char> buffer(syllabary.maxLength() + 1);
+	bool negative = seed < 0;
+	uint64 magnitude = negative ? 0 - (uint64)seed : (uint64)seed;
+	for (int i = 0; i < count; i++, Syllabary::nextSeed(negative, magnitude)) {
+		syllabary.generate(negative, magnitude, &buffer[0]);
+		printf("%s\n", &buffer[0]);
 	}
+	return true;
+}
 
-	bool validate() {
-		int i;
+// -g: expansions of a grammar rule, the i-th drawn from seed + i, with the
+// -v values as $1, $2, ...
+bool generateExpansions(const char *path, const char *rule, long long seed,
+	const std::vector<const char *> &args, int count) {
 
-		int complexClusters = 0;
-		for (i = 0; i < numSegs; i++) {
-			complexClusters += (segs[i].isComplexCluster() ? 1 : 0);
-		}
+	Grammar grammar;
+	if (!grammar.load(path)) {
+		fprintf(stderr, "%s\n", grammar.error().c_str());
+		return false;
+	}
+	int symbol = grammar.symbol(rule);
+	if (symbol < 0) {
+		fprintf(stderr, "no list or rule '%s'\n", rule);
+		return false;
+	}
 
-		int freq[39];
-		memset(freq, 0, 39*sizeof(int));
+	char buffer[GRAMMAR_MAX_TEXT];
+	for (int i = 0; i < count; i++) {
+		KeyedSeed keyed((uint64)seed + i);
+		grammar.expand(symbol, keyed, buffer, sizeof(buffer), args.empty() ? 0 : &args[0], (int)args.size());
+		printf("%s\n", buffer);
+	}
+	return true;
+}
 
-		int cacophony = 0, maxVowel = 0, maxConsonant = 0;
-		for (i = 0; i < numSegs; i++) {
-			for (int j = 0; j < segs[i]._numItems; j++) {
-				freq[segs[i].set[j]._id]++;
-			}
-		}
-		for (i = 0; i < 39; i++) {
-			if (phonemes[i]._props & MASK_VOWEL) {
-				if (freq[i] > maxVowel) maxVowel = freq[i];
-			} else {
-				if (freq[i] > maxConsonant) maxConsonant = freq[i];
-			}
-		}
-		cacophony = ((maxConsonant > 2 || maxVowel > 3) ? 1 : 0);
+// -t: splits the names of a file, one per line, '-' for stdin; prints each
+// segmented, whether it passes the rules and its log probability. -j
+// parses contiguous ranges of the names on that many threads.
+struct ParseRange {
+	const std::vector<std::string>	*names;
+	size_t							begin, end;
+	std::string						output;
+	int								numParsed, numValid;
+};
 
-		int repeats = 0;
-		for (i = 0; i < numSegs - 1; i++) {
-			repeats += (segs[i] == segs[i+1]) ? 1 : 0;
-		}
+static void parseRange(const NameParser &parser, ParseRange &range) {
+	ParsedName parsed;
+	char line[MAX_NAME_LEN + 3 * MAX_NAME_LEN + 64], segmented[3 * MAX_NAME_LEN];
 
-		int middleGlottal = 0;
-		for (i = 1; i < numSegs; i++) {
-			middleGlottal += ((segs[i]._numItems == 1 && segs[i].first()._props & GLOTTAL) ? 1 : 0);
+	range.numParsed = range.numValid = 0;
+	for (size_t i = range.begin; i < range.end; i++) {
+		const char *name = (*range.names)[i].c_str();
+		if (!parser.parse(name, parsed)) {
+			range.output.append(name).append("\t-\tunparsed\n");
+			continue;
 		}
 
-		int complexity = 0;
-		for (i = 0; i < numSegs; i++) {
-			complexity += ((segs[i]._numItems >= 2) ? 1 : 0);
-		}
+		range.numParsed++;
+		range.numValid += parsed.valid;
+		Word(parsed.syllables, parsed.numSyllables).renderSegmented(segmented);
+		snprintf(line, sizeof(line), "\t%s\t%s\t%.3f\n", segmented, parsed.valid ? "valid" : "invalid", parsed.logProb);
+		range.output.append(name).append(line);
+	}
+}
 
-		return (middleGlottal == 0) && (cacophony == 0) && (complexClusters < 3) && (complexity < 2) && (repeats == 0);
+bool parseNames(const char *path, const CountDistribution &syllableCounts, int numThreads) {
+
+	FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (!f) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
 	}
 
-	void render(char *buffer) {
-		char *dst = buffer;
+	std::vector<std::string> names;
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0])
+			names.push_back(line);
+	}
+	if (f != stdin)
+		fclose(f);
+
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	NameParser parser(syllableCounts);
+	std::vector<ParseRange> ranges(numThreads);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		ranges[t].names = &names;
+		ranges[t].begin = names.size() * t / numThreads;
+		ranges[t].end = names.size() * (t + 1) / numThreads;
+		threads.push_back(std::thread(parseRange, std::cref(parser), std::ref(ranges[t])));
+	}
 
-		int i;
-		for (i = 0; i < numSegs; i++) {
-			dst += sprintf(dst, "%s", segs[i]._spelling);
-		}
+	int numParsed = 0, numValid = 0;
+	for (int t = 0; t < numThreads; t++) {
+		threads[t].join();
+		fwrite(ranges[t].output.data(), 1, ranges[t].output.size(), stdout);
+		numParsed += ranges[t].numParsed;
+		numValid += ranges[t].numValid;
 	}
 
-	void renderSegmented(char *buffer) {
-		char *dst = buffer;
+	fprintf(stderr, "%d names, %d parsed, %d valid\n", (int)names.size(), numParsed, numValid);
+	return true;
+}
 
-		int i;
-		for (i = 0; i < numSegs-1; i++) {
-			dst += sprintf(dst, "%s-", segs[i]._spelling);
+// -f: one family per line, names sharing all but their last syllable
+bool generateFamilies(int familySize, int count) {
+	FamilyGenerator families(wordGen);
+	std::vector<char> names((size_t)familySize * MAX_NAME_LEN);
+	int rejected = 0;
+
+	for (int i = 0; i < count; i++) {
+		int n = families.generate(&names[0], familySize, openSeed, &rejected);
+		if (n < familySize) {
+			fprintf(stderr, "no root completes %d different names, the last one made %d\n", familySize, n);
+			return false;
 		}
-		sprintf(dst, "%s", segs[i]._spelling);
+		for (int k = 0; k < familySize; k++)
+			printf(k + 1 < familySize ? "%s " : "%s\n", &names[(size_t)k * MAX_NAME_LEN]);
 	}
 
+	fprintf(stderr, "%d families, %d rejected draws\n", count, rejected);
+	return true;
+}
+
+// names per LiveModel pin in -w
+#define LIVE_BLOCK	1024
 
-	void render2(char *buffer) {
+static long long modifiedTime(const char *path) {
+	struct stat st;
+	return path && stat(path, &st) == 0 ? (long long)st.st_mtime : 0;
+}
 
-		char temp[100];
-		char *dst = temp;
+// -w: names from a weights file and optionally a rules file, each reloaded
+// when it changes on disk while the threads keep generating
+bool generateLive(const char *weightsPath, const char *rulesPath, int count, int numThreads) {
+	PhonologyModel *model = new PhonologyModel;
+	if (!model->load(weightsPath, rulesPath)) {
+		fprintf(stderr, "%s\n", model->error().c_str());
+		delete model;
+		return false;
+	}
 
-		int i;
-		for (i = 0; i < numSegs; i++) {
-			dst += sprintf(dst, "%s", segs[i]._spelling);
+	LiveModel live(model);
+	std::atomic<bool> done(false);
+	std::mutex outLock;
+
+	std::thread watcher([&]() {
+		long long weightsTime = modifiedTime(weightsPath);
+		long long rulesTime = modifiedTime(rulesPath);
+		while (!done.load()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			long long w = modifiedTime(weightsPath), r = modifiedTime(rulesPath);
+			if (w == weightsTime && r == rulesTime)
+				continue;
+			weightsTime = w;
+			rulesTime = r;
+			if (live.reload(weightsPath, rulesPath))
+				fprintf(stderr, "reloaded %s\n", weightsPath);
+			else
+				fprintf(stderr, "%s, keeping the current model\n", live.error().c_str());
 		}
-
-		char temp2[100];
-		type cl, cl2;
-		int j = 0;
-
-		i = 0;
-		cl2 = getType(temp[i]);
-		while (cl2 != kNone) {
-			temp2[j++] = temp[i];
-			i++;
-
-			cl = getType(temp[i]);
-			if (cl == 0) {
-				temp2[j++] = '\0';
-			} else
-			if (cl != cl2) {
-				temp2[j++] = '-';
+	});
+
+	if (numThreads < 1)
+		numThreads = 1;
+	if (numThreads > LIVE_MODEL_READERS)
+		numThreads = LIVE_MODEL_READERS;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		threads.push_back(std::thread([&, t]() {
+			int reader = live.addReader();
+			RandSeed seed(t);
+			std::string out;
+			char buffer[MAX_NAME_LEN];
+
+			for (int first = t * LIVE_BLOCK; first < count; first += numThreads * LIVE_BLOCK) {
+				int n = count - first < LIVE_BLOCK ? count - first : LIVE_BLOCK;
+				{
+					LiveModel::Pin pin(live, reader);
+					const PositionalTables &tables = pin.model().tables();
+					for (int i = 0; i < n; i++) {
+						while (!wordGen.generate(buffer, seed, tables))
+							;
+						out += buffer;
+						out += '\n';
+					}
+				}
+
+				std::lock_guard<std::mutex> guard(outLock);
+				fwrite(out.data(), 1, out.size(), stdout);
+				out.clear();
 			}
-			cl2 = cl;
-		}
-
-		strcpy(buffer, temp2);
+		}));
 	}
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
 
-};
+	done.store(true);
+	watcher.join();
+	return true;
+}
 
+// -a: statistics of the name distribution, count is the number of draws
+void printAnalysis(const CountDistribution &syllableCounts, int draws) {
+
+	NameAnalyzer analyzer(syllableCounts);
+	NameStats stats;
+
+	analyzer.analyze(stats);
+
+	printf("valid words         %.0f\n", stats.validWords);
+	printf("acceptance          %.4f\n", stats.acceptance);
+	printf("entropy             %.3f bits\n", stats.entropy);
+	printf("collision           %.4g\n", stats.collision);
+	printf("rendered collision  %.4g (x%.2f)\n", stats.renderedCollision, stats.collapse);
+	// names repeat sooner than segment sequences, different words spelling alike
+	printf("50%% repeat after    %.0f draws (words %.0f)\n",
+		NameAnalyzer::drawsForCollision(stats.renderedCollision, 0.5), NameAnalyzer::drawsForCollision(stats.collision, 0.5));
+	printf("distinct names      ~%.0f of %d draws (words %.0f)\n",
+		analyzer.expectedDistinct(draws, stats.collapse), draws, analyzer.expectedDistinct(draws));
+	if (!stats.exact)
+		printf("(maxcount expansion cut off, figures are approximate)\n");
+}
 
+int main(int argc, char *argv[]) {
 
+	int len = 1;
+	bool constrained = false;
+	bool batched = false;
+	bool analyze = false;
+	CountDistribution syllableCounts;
+	int maxDistance = 0;
+	Blocklist blocklist;
+	const char *catalogPath = 0;
+	bool entities = false;
+	int enumerateSyllables = 0;
+	int numThreads = 0;
+	bool ordered = true;
+	uint64 galaxySeed = 0;
+	const char *corpusPath = 0;
+	const char *grammarPath = 0;
+	const char *grammarRule = 0;
+	const char *parsePath = 0;
+	std::vector<const char *> grammarArgs;
+	long long textSeed = 0;
+	NameConstraints constraints;
+	int familySize = 0;
+	bool codes = false;
+	std::string weightsPath;
+	const char *refillPool = 0;
+	const char *claimPool = 0;
+	int poolConsumers = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+			constraints.prefix = argv[++i];
+			constrained = true;
+		} else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+			const char *range = argv[++i];
+			constraints.minLength = atoi(range);
+			constraints.maxLength = strchr(range, ':') ? atoi(strchr(range, ':') + 1) : constraints.minLength;
+			constrained = true;
+		} else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+			CountDistribution counts;
+			if (!parseSyllableCounts(argv[++i], counts)) {
+				fprintf(stderr, "-k expects count:weight[,count:weight...]\n");
+				return 1;
+			}
+			wordGen.setSyllableCounts(counts);
+			syllableCounts = counts;
+		} else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+			maxDistance = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-x") && i + 1 < argc) {
+			if (!blocklist.load(argv[++i])) {
+				fprintf(stderr, "%s\n", blocklist.error().c_str());
+				return 1;
+			}
+			wordGen.setBlocklist(&blocklist);
+		} else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+			catalogPath = argv[++i];
+		} else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+			galaxySeed = strtoull(argv[++i], 0, 0);
+			entities = true;
+		} else if (!strcmp(argv[i], "-y") && i + 1 < argc) {
+			corpusPath = argv[++i];
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			textSeed = strtoll(argv[++i], 0, 0);
+		} else if (!strcmp(argv[i], "-g") && i + 2 < argc) {
+			grammarPath = argv[++i];
+			grammarRule = argv[++i];
+		} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			parsePath = argv[++i];
+		} else if (!strcmp(argv[i], "-v") && i + 1 < argc) {
+			grammarArgs.push_back(argv[++i]);
+		} else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			enumerateSyllables = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+			numThreads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-u")) {
+			ordered = false;
+		} else if (!strcmp(argv[i], "-q")) {
+			openSeed.select(quasiSeed);
+			closedSeed.select(quasiSeed);
+		} else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+			// share of the Italian tables
+			double italian = atof(argv[++i]);
+			double weights[kNumLanguages] = { 1.0 - italian, italian };
+			wordGen.setTables(&mixedTables(weights));
+		} else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+			familySize = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+			weightsPath = argv[++i];
+		} else if (!strcmp(argv[i], "-W")) {
+			SegmentDistribution dists[kNumSlots];
+			en_setupOnsets(dists[kSlotOnset]);
+			en_setupNuclei(dists[kSlotNucleus]);
+			en_setupCodas(dists[kSlotCoda]);
+			writeWeights(stdout, dists);
+			return 0;
+		} else if (!strcmp(argv[i], "-P") && i + 1 < argc) {
+			refillPool = argv[++i];
+		} else if (!strcmp(argv[i], "-C") && i + 1 < argc) {
+			claimPool = argv[++i];
+		} else if (!strcmp(argv[i], "-N") && i + 1 < argc) {
+			poolConsumers = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-i")) {
+			codes = true;
+		} else if (!strcmp(argv[i], "-o")) {
+			wordGen.setOrthography(&en_orthography());
+		} else if (!strcmp(argv[i], "-a")) {
+			analyze = true;
+		} else if (!strcmp(argv[i], "-b")) {
+			batched = true;
+		} else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			constraints.numSyllables = atoi(argv[++i]);
+			constrained = true;
+		} else {
+			len = atoi(argv[i]);
+			if (len <= 0) {
+				len = 1;
+			}
+		}
+	}
 
+	if (analyze) {
+		if (syllableCounts.size() == 0)
+			syllableCounts.addItem((unsigned char)2, 1);
+		printAnalysis(syllableCounts, len);
+		return 0;
+	}
 
+	// -t names, -k syllable counts, -j threads
+	if (parsePath) {
+		if (syllableCounts.size() == 0)
+			syllableCounts.addItem((unsigned char)2, 1);
+		return parseNames(parsePath, syllableCounts, numThreads) ? 0 : 1;
+	}
 
-RandSeed seed0(0);
-RandSeed seed1(1);
+	// -n: every valid word of that many syllables, -j threads, -u in any order
+	if (enumerateSyllables > 0) {
+		WordEnumerator enumerator(en_phonotactics());
+		enumerator.setOrthography(wordGen.orthography());
+		enumerator.setBlocklist(wordGen.blocklist());
+		enumerator.run(enumerateSyllables, numThreads, ordered, stdout);
+		return 0;
+	}
 
-EnglishOpenSyllableGenerator   openGen(seed0);
-EnglishClosedSyllableGenerator closedGen(seed1);
+	// -y corpus, -r seed
+	if (corpusPath)
+		return generateSpliced(corpusPath, textSeed, len) ? 0 : 1;
 
-bool generateWord() {
+	// -g grammar rule, -v values, -r seed
+	if (grammarPath)
+		return generateExpansions(grammarPath, grammarRule, textSeed, grammarArgs, len) ? 0 : 1;
 
-	Syllable syl[3];
-	char buffer[100];
-	bool r = false;
+	// -w weights[:rules], -j threads
+	if (!weightsPath.empty()) {
+		size_t colon = weightsPath.find(':');
+		std::string rulesPath = colon == std::string::npos ? "" : weightsPath.substr(colon + 1);
+		weightsPath = weightsPath.substr(0, colon);
+		return generateLive(weightsPath.c_str(), rulesPath.empty() ? 0 : rulesPath.c_str(), len, numThreads) ? 0 : 1;
+	}
 
-	openGen.genSyllable(syl[0]);
-	closedGen.genSyllable(syl[1]);
-//	openGen.genSyllable(syl[1]);
-	//closedGen.genSyllable(syl[2]);
+	// -f: count families of that many names
+	if (familySize > 0) {
+		return generateFamilies(familySize, len) ? 0 : 1;
+	}
 
-	Word word(syl, 2);
-	word.render(buffer);
+	// -N consumer threads, -j producer threads
+	if (poolConsumers > 0) {
+		generatePooled(poolConsumers, numThreads, len);
+		return 0;
+	}
 
-	if (word.validate()) {
-		printf("%s\n", buffer);
-		r = true;
-	} else {
-		printf("%s -> REJECTED\n", buffer);
+	// -P shared pool of count names, -e galaxy seed
+	if (refillPool)
+		return refillSharedPool(refillPool, len, galaxySeed) ? 0 : 1;
+
+	// -C shared pool to claim count names from
+	if (claimPool)
+		return claimSharedNames(claimPool, len) ? 0 : 1;
+
+	// -i codes, -e galaxy seed
+	if (codes) {
+		printEntityCodes(galaxySeed, len);
+		return 0;
 	}
 
-	return r;
-}
+	if (catalogPath && entities)
+		return writeEntityCatalog(catalogPath, galaxySeed, len) ? 0 : 1;
 
-int main(int argc, char *argv[]) {
+	if (catalogPath)
+		return writeCatalog(catalogPath, len) ? 0 : 1;
 
-	int len = 1;
+	if (constrained)
+		return generateConstrained(constraints, len) ? 0 : 1;
 
-	if (argc > 1) {
-		len = atoi(argv[1]);
-		if (len <= 0) {
-			len = 1;
-		}
+	if (maxDistance > 0) {
+		generateDistinct(maxDistance, len);
+		return 0;
+	}
+
+	if (batched) {
+		generateBatched(len);
+		return 0;
 	}
 
 	int numRejected = 0;
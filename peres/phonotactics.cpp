@@ -0,0 +1,616 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "phonotactics.h"
+
+enum TermKind {
+	kTermAny,
+	kTermSlot,
+	kTermSingle,
+	kTermCluster,
+	kTermVowel,
+	kTermConsonant,
+	kTermProps,
+	kTermBind,			// sel=$N, replaced by kTermPhoneme when expanded
+	kTermPhoneme,
+	kTermSpelling		// 'text|text*'
+};
+
+enum TermSelector {
+	kSelFirst,
+	kSelLast,
+	kSelAny,
+	kSelAll
+};
+
+struct Phonotactics::Term {
+	int							kind;
+	int							selector;
+	unsigned int				value;		// slot, props, variable or phoneme id
+	bool						negate;
+	std::vector<std::string>	spellings;	// a trailing '*' matches any suffix
+};
+
+struct Phonotactics::Item {
+	std::vector<Term>	terms;
+};
+
+struct Phonotactics::Pattern {
+	bool				anchored;
+	std::vector<Item>	items;
+};
+
+struct Phonotactics::Limit {
+	int		max;
+	Item	item;
+};
+
+static const struct {
+	const char		*name;
+	unsigned int	props;
+} features[] = {
+	{ "FRICATIVE",		FRICATIVE },
+	{ "PLOSIVE",		PLOSIVE },
+	{ "AFFRICATE",		AFFRICATE },
+	{ "NASAL",			NASAL },
+	{ "APPROXIMANT",	APPROXIMANT },
+	{ "LATERAL",		LATERAL },
+	{ "BILABIAL",		BILABIAL },
+	{ "LABIODENTAL",	LABIODENTAL },
+	{ "DENTAL",			DENTAL },
+	{ "GLOTTAL",		GLOTTAL },
+	{ "PALATAL",		PALATAL },
+	{ "ALVEOLAR",		ALVEOLAR },
+	{ "POSTALVEOLAR",	POSTALVEOLAR },
+	{ "VELAR",			VELAR },
+	{ "LABIOVELAR",		LABIOVELAR },
+	{ "VOICED",			VOICED },
+	{ "VOICELESS",		VOICELESS },
+	{ "SHORT_VOWEL",	SHORT_VOWEL },
+	{ "LONG_VOWEL",		LONG_VOWEL },
+	{ 0, 0 }
+};
+
+// nibble counters live in three 64 bit words
+
+static bool isVowelPhoneme(const Phoneme &p) {
+	return (p._props & MASK_VOWEL) != 0;
+}
+
+static void split(const std::string &text, char separator, std::vector<std::string> &parts) {
+	std::string part;
+	std::istringstream in(text);
+	while (std::getline(in, part, separator))
+		parts.push_back(part);
+}
+
+Phonotactics::Phonotactics() :
+	_segments(0), _numSegments(0), _numClasses(0), _numStates(0),
+	_startState(kDeadState), _midState(kDeadState), _noRepeat(false) {
+
+	_countBias[0] = _countBias[1] = _countBias[2] = 0;
+}
+
+bool Phonotactics::fail(int line, const std::string &message) {
+	char prefix[32] = "";
+	if (line > 0)
+		sprintf(prefix, "line %d: ", line);
+	_error = prefix + message;
+	return false;
+}
+
+bool Phonotactics::parseTerm(const std::string &text, Term &term) const {
+	std::string t = text;
+
+	term.kind = kTermAny;
+	term.selector = kSelFirst;
+	term.value = 0;
+	term.negate = false;
+
+	if (!t.empty() && t[0] == '!') {
+		term.negate = true;
+		t = t.substr(1);
+	}
+
+	if (t == "_") {
+		return true;
+	}
+	if (t == "onset" || t == "nucleus" || t == "coda") {
+		term.kind = kTermSlot;
+		term.value = (t == "onset") ? kSlotOnset : ((t == "nucleus") ? kSlotNucleus : kSlotCoda);
+		return true;
+	}
+	if (t == "single" || t == "cluster") {
+		term.kind = (t == "single") ? kTermSingle : kTermCluster;
+		return true;
+	}
+	if (t == "vowel" || t == "consonant") {
+		term.kind = (t == "vowel") ? kTermVowel : kTermConsonant;
+		return true;
+	}
+	if (t.size() >= 2 && t[0] == '\'' && t[t.size() - 1] == '\'') {
+		term.kind = kTermSpelling;
+		split(t.substr(1, t.size() - 2), '|', term.spellings);
+		return !term.spellings.empty();
+	}
+
+	std::string sel;
+	size_t sep = t.find_first_of(":=");
+	if (sep != std::string::npos) {
+		sel = t.substr(0, sep);
+		if (sel == "first")
+			term.selector = kSelFirst;
+		else if (sel == "last")
+			term.selector = kSelLast;
+		else if (sel == "any")
+			term.selector = kSelAny;
+		else if (sel == "all")
+			term.selector = kSelAll;
+		else
+			return false;
+
+		if (t[sep] == '=') {
+			if (t.size() < sep + 3 || t[sep + 1] != '$')
+				return false;
+			term.kind = kTermBind;
+			term.value = atoi(t.c_str() + sep + 2);
+			return term.value > 0;
+		}
+		t = t.substr(sep + 1);
+	}
+
+	std::vector<std::string> names;
+	split(t, '|', names);
+	if (names.empty())
+		return false;
+
+	term.kind = kTermProps;
+	for (size_t i = 0; i < names.size(); i++) {
+		int f;
+		for (f = 0; features[f].name; f++)
+			if (names[i] == features[f].name)
+				break;
+		if (!features[f].name)
+			return false;
+		term.value |= features[f].props;
+	}
+
+	return true;
+}
+
+bool Phonotactics::parseItem(const std::string &text, Item &item) const {
+	std::vector<std::string> parts;
+	split(text, ',', parts);
+	if (parts.empty())
+		return false;
+
+	item.terms.resize(parts.size());
+	for (size_t i = 0; i < parts.size(); i++)
+		if (!parseTerm(parts[i], item.terms[i]))
+			return false;
+
+	return true;
+}
+
+static bool selectPhoneme(const Segment &seg, int selector, bool (*test)(const Phoneme &, unsigned int), unsigned int value) {
+	if (seg._numItems == 0)
+		return false;
+
+	switch (selector) {
+	case kSelFirst:
+		return test(seg.first(), value);
+	case kSelLast:
+		return test(seg.last(), value);
+	case kSelAny:
+		for (int i = 0; i < seg._numItems; i++)
+			if (test(seg.item(i), value))
+				return true;
+		return false;
+	default:
+		for (int i = 0; i < seg._numItems; i++)
+			if (!test(seg.item(i), value))
+				return false;
+		return true;
+	}
+}
+
+static bool testProps(const Phoneme &p, unsigned int props) {
+	return p.hasProps(props);
+}
+
+static bool testId(const Phoneme &p, unsigned int id) {
+	return p._id == (int)id;
+}
+
+static bool testSpelling(const Segment &seg, const std::vector<std::string> &spellings) {
+	const char *spelling = seg._spelling ? seg._spelling : "";
+
+	for (size_t i = 0; i < spellings.size(); i++) {
+		const std::string &s = spellings[i];
+		if (!s.empty() && s[s.size() - 1] == '*') {
+			if (!strncmp(spelling, s.c_str(), s.size() - 1))
+				return true;
+		} else if (s == spelling) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Phonotactics::matches(const Item &item, int slot, const Segment &seg) const {
+	for (size_t i = 0; i < item.terms.size(); i++) {
+		const Term &t = item.terms[i];
+		bool r;
+
+		switch (t.kind) {
+		case kTermSlot:
+			r = (slot == (int)t.value);
+			break;
+		case kTermSingle:
+			r = (seg._numItems == 1);
+			break;
+		case kTermCluster:
+			r = seg.isComplexCluster();
+			break;
+		case kTermVowel:
+			r = seg._numItems > 0 && isVowelPhoneme(seg.first());
+			break;
+		case kTermConsonant:
+			r = seg._numItems > 0 && !isVowelPhoneme(seg.first());
+			break;
+		case kTermProps:
+			r = selectPhoneme(seg, t.selector, testProps, t.value);
+			break;
+		case kTermPhoneme:
+			r = selectPhoneme(seg, t.selector, testId, t.value);
+			break;
+		case kTermSpelling:
+			r = seg._numItems > 0 && testSpelling(seg, t.spellings);
+			break;
+		default:
+			r = true;
+			break;
+		}
+
+		if (r == t.negate)
+			return false;
+	}
+
+	return true;
+}
+
+bool Phonotactics::itemSymbols(const std::string &text, std::vector<char> &symbols) const {
+	Item item;
+
+	if (!parseItem(text, item))
+		return false;
+	for (size_t i = 0; i < item.terms.size(); i++)
+		if (item.terms[i].kind == kTermBind)
+			return false;
+
+	symbols.assign(kNumSlots * _numSegments, 0);
+	for (int slot = 0; slot < kNumSlots; slot++)
+		for (int id = 0; id < _numSegments; id++)
+			symbols[slot * _numSegments + id] = matches(item, slot, *_segments[id]);
+
+	return true;
+}
+
+bool Phonotactics::load(const char *path, const SegmentInventory &inventory) {
+	std::string text;
+	if (!readFile(path, text)) {
+		_error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	return compile(text.c_str(), inventory);
+}
+
+bool Phonotactics::compile(const char *rules, const SegmentInventory &inventory) {
+
+	std::vector<Pattern> patterns;
+	std::vector<Limit> limits;
+	int maxCount[MAX_COUNTED_PHONEMES];
+	int i, j;
+
+	for (i = 0; i < MAX_COUNTED_PHONEMES; i++)
+		maxCount[i] = -1;
+
+	_segments = inventory.segments;
+	_numSegments = inventory.size;
+	_noRepeat = false;
+	_error.clear();
+
+	// phonemes occurring in the inventory, the range of $N variables
+	std::set<int> phonemeIds;
+	for (i = 0; i < _numSegments; i++)
+		for (j = 0; j < inventory[i]._numItems; j++)
+			phonemeIds.insert(inventory[i].set[j]._id);
+
+	std::vector<std::string> lines;
+	split(rules, '\n', lines);
+
+	for (size_t l = 0; l < lines.size(); l++) {
+		int line = (int)l + 1;
+		std::string text = lines[l].substr(0, lines[l].find('#'));
+		std::istringstream in(text);
+		std::vector<std::string> words;
+		std::string word;
+
+		while (in >> word)
+			words.push_back(word);
+		if (words.empty())
+			continue;
+
+		if (words[0] == "forbid") {
+			Pattern p;
+			size_t w = 1;
+
+			p.anchored = (words.size() > 1 && words[1] == "^");
+			if (p.anchored)
+				w++;
+			if (w >= words.size())
+				return fail(line, "forbid needs at least one item");
+
+			for (; w < words.size(); w++) {
+				Item item;
+				if (!parseItem(words[w], item))
+					return fail(line, "bad item '" + words[w] + "'");
+				p.items.push_back(item);
+			}
+
+			// expand $N variables over every phoneme of the inventory
+			std::vector<Pattern> expanded(1, p);
+			for (int var = 1; var <= 9; var++) {
+				bool used = false;
+				for (size_t k = 0; k < p.items.size(); k++)
+					for (size_t m = 0; m < p.items[k].terms.size(); m++)
+						used = used || (p.items[k].terms[m].kind == kTermBind && p.items[k].terms[m].value == (unsigned int)var);
+				if (!used)
+					continue;
+
+				std::vector<Pattern> next;
+				for (size_t e = 0; e < expanded.size(); e++) {
+					for (std::set<int>::iterator id = phonemeIds.begin(); id != phonemeIds.end(); ++id) {
+						Pattern c = expanded[e];
+						for (size_t k = 0; k < c.items.size(); k++) {
+							for (size_t m = 0; m < c.items[k].terms.size(); m++) {
+								Term &t = c.items[k].terms[m];
+								if (t.kind == kTermBind && t.value == (unsigned int)var) {
+									t.kind = kTermPhoneme;
+									t.value = *id;
+								}
+							}
+						}
+						next.push_back(c);
+					}
+				}
+				expanded.swap(next);
+			}
+			patterns.insert(patterns.end(), expanded.begin(), expanded.end());
+
+		} else if (words[0] == "limit") {
+			Limit lim;
+			if (words.size() != 3 || (lim.max = atoi(words[1].c_str())) < 0 || !isdigit((unsigned char)words[1][0]))
+				return fail(line, "usage: limit N item");
+			if (!parseItem(words[2], lim.item))
+				return fail(line, "bad item '" + words[2] + "'");
+			for (size_t m = 0; m < lim.item.terms.size(); m++)
+				if (lim.item.terms[m].kind == kTermBind)
+					return fail(line, "variables only make sense in forbid rules");
+			limits.push_back(lim);
+
+		} else if (words[0] == "norepeat") {
+			if (words.size() != 1)
+				return fail(line, "norepeat takes no arguments");
+			_noRepeat = true;
+
+		} else if (words[0] == "maxcount") {
+			if (words.size() != 3 || !isdigit((unsigned char)words[1][0]))
+				return fail(line, "usage: maxcount N vowel|consonant|FEATURES");
+
+			int max = atoi(words[1].c_str());
+			if (max > 7)
+				return fail(line, "maxcount limit must be below 8");
+
+			Term term;
+			if (words[2] == "vowel" || words[2] == "consonant") {
+				term.kind = kTermAny;
+			} else if (!parseTerm(words[2], term) || term.kind != kTermProps) {
+				return fail(line, "bad phoneme class '" + words[2] + "'");
+			}
+
+			for (int s = 0; s < _numSegments; s++) {
+				for (j = 0; j < inventory[s]._numItems; j++) {
+					const Phoneme &p = inventory[s].set[j];
+					bool member;
+
+					if (words[2] == "vowel")
+						member = isVowelPhoneme(p);
+					else if (words[2] == "consonant")
+						member = !isVowelPhoneme(p);
+					else
+						member = p.hasProps(term.value);
+
+					if (!member)
+						continue;
+					if (p._id >= MAX_COUNTED_PHONEMES)
+						return fail(line, "phoneme id out of range for maxcount");
+					if (maxCount[p._id] < 0 || max < maxCount[p._id])
+						maxCount[p._id] = max;
+				}
+			}
+
+		} else {
+			return fail(line, "unknown rule '" + words[0] + "'");
+		}
+	}
+
+	// phoneme counters: bias every limited nibble to 7 - limit
+	_countBias[0] = _countBias[1] = _countBias[2] = 0;
+	for (i = 0; i < MAX_COUNTED_PHONEMES; i++)
+		if (maxCount[i] >= 0)
+			_countBias[i / 16] |= (uint64)(7 - maxCount[i]) << (4 * (i % 16));
+
+	_countIncrements.assign(_numSegments * 3, 0);
+	for (i = 0; i < _numSegments; i++)
+		for (j = 0; j < inventory[i]._numItems; j++) {
+			int id = inventory[i].set[j]._id;
+			if (id < MAX_COUNTED_PHONEMES && maxCount[id] >= 0)
+				_countIncrements[i * 3 + id / 16] += (uint64)1 << (4 * (id % 16));
+		}
+
+	// segments comparing equal share a content class, for norepeat
+	_contentClass.resize(_numSegments);
+	for (i = 0; i < _numSegments; i++) {
+		_contentClass[i] = i;
+		for (j = 0; j < i; j++)
+			if (inventory[j] == inventory[i]) {
+				_contentClass[i] = _contentClass[j];
+				break;
+			}
+	}
+
+	// symbols matching exactly the same items are interchangeable and share
+	// a column of the transition table
+	std::vector<const Item*> items;
+	for (i = 0; i < (int)patterns.size(); i++)
+		for (j = 0; j < (int)patterns[i].items.size(); j++)
+			items.push_back(&patterns[i].items[j]);
+	for (i = 0; i < (int)limits.size(); i++)
+		items.push_back(&limits[i].item);
+
+	std::map<std::vector<bool>, int> signatures;
+	std::vector<std::vector<bool> > classSignature;
+
+	_classOf.assign(kNumSlots * _numSegments, 0);
+	for (int slot = 0; slot < kNumSlots; slot++) {
+		for (i = 0; i < _numSegments; i++) {
+			std::vector<bool> sig(items.size());
+			for (j = 0; j < (int)items.size(); j++)
+				sig[j] = matches(*items[j], slot, inventory[i]);
+
+			std::map<std::vector<bool>, int>::iterator it = signatures.find(sig);
+			if (it == signatures.end()) {
+				it = signatures.insert(std::make_pair(sig, (int)classSignature.size())).first;
+				classSignature.push_back(sig);
+			}
+			_classOf[slot * _numSegments + i] = (unsigned short)it->second;
+		}
+	}
+	_numClasses = (int)classSignature.size();
+
+	// where each pattern's items start in a signature
+	std::vector<int> itemBase(patterns.size());
+	int numPatternItems = 0;
+	for (i = 0; i < (int)patterns.size(); i++) {
+		itemBase[i] = numPatternItems;
+		numPatternItems += (int)patterns[i].items.size();
+	}
+
+	// subset construction; a state is the word start flag, the counter of
+	// every limit and the sorted (pattern, matched items) partial matches
+	std::map<std::vector<int>, int> stateIds;
+	std::vector<std::vector<int> > states;
+
+	std::vector<int> dead(1, -1);
+	stateIds[dead] = kDeadState;
+	states.push_back(dead);
+
+	std::vector<int> start(1 + limits.size(), 0), mid(1 + limits.size(), 0);
+	start[0] = 1;
+
+	_startState = stateIds[start] = (int)states.size();
+	states.push_back(start);
+	if (stateIds.find(mid) == stateIds.end()) {
+		stateIds[mid] = (int)states.size();
+		states.push_back(mid);
+	}
+	_midState = stateIds[mid];
+
+	_table.clear();
+	for (size_t s = 0; s < states.size(); s++) {
+		std::vector<int> state = states[s];
+
+		for (int c = 0; c < _numClasses; c++) {
+			const std::vector<bool> &sig = classSignature[c];
+			int target = kDeadState;
+
+			if (s != kDeadState) {
+				std::vector<int> next(1 + limits.size(), 0);
+				std::vector<int> partial;
+				bool isDead = false;
+
+				for (size_t l = 0; l < limits.size() && !isDead; l++) {
+					next[1 + l] = state[1 + l] + (sig[numPatternItems + l] ? 1 : 0);
+					isDead = next[1 + l] > limits[l].max;
+				}
+
+				// partial matches are encoded as pattern * 256 + matched items
+				std::vector<int> active(state.begin() + 1 + limits.size(), state.end());
+				for (i = 0; i < (int)patterns.size(); i++)
+					if (!patterns[i].anchored || state[0])
+						active.push_back(i * 256);
+
+				for (size_t a = 0; a < active.size() && !isDead; a++) {
+					int p = active[a] / 256, pos = active[a] % 256;
+					if (!sig[itemBase[p] + pos])
+						continue;
+					if (pos + 1 == (int)patterns[p].items.size())
+						isDead = true;
+					else
+						partial.push_back(p * 256 + pos + 1);
+				}
+
+				if (!isDead) {
+					std::sort(partial.begin(), partial.end());
+					partial.erase(std::unique(partial.begin(), partial.end()), partial.end());
+					next.insert(next.end(), partial.begin(), partial.end());
+
+					std::map<std::vector<int>, int>::iterator it = stateIds.find(next);
+					if (it == stateIds.end()) {
+						it = stateIds.insert(std::make_pair(next, (int)states.size())).first;
+						states.push_back(next);
+						if (states.size() > 65535)
+							return fail(0, "rule set needs too many states");
+					}
+					target = it->second;
+				}
+			}
+
+			_table.push_back((unsigned short)target);
+		}
+	}
+	_numStates = (int)states.size();
+
+	_table.push_back(kDeadState);
+	_classOf.push_back(0);
+
+	return true;
+}
+
+bool Phonotactics::acceptsSyllable(const Syllable &s) const {
+	int ids[3];
+	unsigned char slots[3];
+	int n = 0;
+
+	if (s.hasOnset()) {
+		ids[n] = s.onset._id;
+		slots[n++] = kSlotOnset;
+	}
+	ids[n] = s.nucleus._id;
+	slots[n++] = kSlotNucleus;
+	if (s.hasCoda()) {
+		ids[n] = s.coda._id;
+		slots[n++] = kSlotCoda;
+	}
+
+	return accepts(ids, slots, n, _midState);
+}
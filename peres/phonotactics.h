@@ -0,0 +1,244 @@
+#ifndef __PHONOTACTICS__
+#define __PHONOTACTICS__
+
+#include <string>
+#include <vector>
+
+#include "misc.h"
+#include "phonetics.h"
+
+// phonemes with ids below this can be limited by maxcount, one nibble each
+#define MAX_COUNTED_PHONEMES	48
+
+// Phonotactic rules as data, compiled into one table driven DFA.
+//
+// A rule set is a text with one rule per line, '#' starting a comment:
+//
+//   forbid [^] item item ...   no run of consecutive segments may match the
+//                              items, '^' anchors the run at the word start
+//   limit N item               at most N segments of the word match item
+//   norepeat                   no segment directly followed by an equal one
+//   maxcount N vowel|consonant|FEATURES
+//                              no single phoneme of that class occurs more
+//                              than N (< 8) times in the word
+//
+// An item is a comma separated list of terms which must all hold:
+//
+//   _                          any segment
+//   onset, nucleus, coda       the slot of the segment in its syllable
+//   single, cluster            one phoneme / more than one phoneme
+//   vowel, consonant           class of the first phoneme
+//   [sel:]FEATURE|FEATURE...   the selected phoneme has all the features, as
+//                              in Phoneme::hasProps; sel is first (default),
+//                              last, any or all
+//   sel=$N                     binds variable N to the selected phoneme, or
+//                              requires it to be the one bound before
+//   'text|text*...'            the segment's table spelling is one of these,
+//                              '*' at the end of one matches any rest
+//   !term                      negation
+//
+// forbid and limit rules are multiplied into a single DFA whose alphabet is
+// (slot, segment id); rules comparing phonemes with each other (norepeat,
+// maxcount) are not regular in any compact way and are evaluated with
+// packed counters during the same walk. Validating a word is one linear
+// pass over its segment ids, however many rules there are.
+class Phonotactics {
+
+public:
+	enum {
+		kDeadState = 0
+	};
+
+private:
+	struct Term;
+	struct Item;
+	struct Pattern;
+	struct Limit;
+
+	const Segment * const		*_segments;
+	int							_numSegments;
+
+	std::vector<unsigned short>	_classOf;		// [slot * _numSegments + id]
+	std::vector<unsigned short>	_table;			// [state * _numClasses + class]
+	int							_numClasses;
+	int							_numStates;
+	int							_startState;
+	int							_midState;
+
+	bool						_noRepeat;
+	std::vector<int>			_contentClass;	// [id], equal segments share it
+
+	uint64						_countBias[3];
+	std::vector<uint64>			_countIncrements;	// [id * 3 + word]
+
+	std::string					_error;
+
+	bool parseTerm(const std::string &text, Term &term) const;
+	bool parseItem(const std::string &text, Item &item) const;
+	bool matches(const Item &item, int slot, const Segment &seg) const;
+	bool fail(int line, const std::string &message);
+
+public:
+	Phonotactics();
+
+	// false on syntax errors, see error()
+	bool compile(const char *rules, const SegmentInventory &inventory);
+	bool load(const char *path, const SegmentInventory &inventory);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	// the symbol fed to the automaton for a segment in a slot
+	int symbolClass(int slot, int id) const {
+		return _classOf[slot * _numSegments + id];
+	}
+
+	int step(int state, int slot, int id) const {
+		return _table[state * _numClasses + symbolClass(slot, id)];
+	}
+
+	int startState() const {
+		return _startState;
+	}
+
+	// state for text somewhere inside a word: anchored rules and counters
+	// off, so it never rejects what a whole word walk would accept
+	int midState() const {
+		return _midState;
+	}
+
+	int numStates() const {
+		return _numStates;
+	}
+
+	int numClasses() const {
+		return _numClasses;
+	}
+
+	// raw tables for vectorized walks; both are padded by one entry so that
+	// 32 bit gathers of the last element stay inside them
+	const unsigned short *table() const {
+		return &_table[0];
+	}
+
+	const unsigned short *classTable() const {
+		return &_classOf[0];
+	}
+
+	int numSegments() const {
+		return _numSegments;
+	}
+
+	bool noRepeat() const {
+		return _noRepeat;
+	}
+
+	const int *contentClasses() const {
+		return &_contentClass[0];
+	}
+
+	// three words per segment id, see extend()
+	const uint64 *countIncrements() const {
+		return &_countIncrements[0];
+	}
+
+	const uint64 *countBias() const {
+		return _countBias;
+	}
+
+	// occurrences of a maxcount limited phoneme in segment id, 0 for
+	// phonemes no rule limits
+	int phonemeCount(int id, int phoneme) const {
+		return (int)(_countIncrements[id * 3 + phoneme / 16] >> (4 * (phoneme % 16))) & 15;
+	}
+
+	// the maxcount limit of a phoneme that phonemeCount() counts
+	int phonemeLimit(int phoneme) const {
+		return 7 - (int)((_countBias[phoneme / 16] >> (4 * (phoneme % 16))) & 15);
+	}
+
+	// the rules walked over the first segments of a word; a copy continues
+	// into each word sharing them, so a common prefix is checked once
+	struct Walk {
+		uint64	counts[3];
+		uint64	overflow;
+		int		state;
+		int		prev;
+		int		repeats;
+	};
+
+	Walk startWalk(int state) const {
+		Walk walk = { { _countBias[0], _countBias[1], _countBias[2] }, 0, state, -1, 0 };
+		return walk;
+	}
+
+	Walk startWalk() const {
+		return startWalk(_startState);
+	}
+
+	// runs the DFA, the repeat check and the phoneme counters in one pass
+	// over segment ids and slots
+	void extend(Walk &walk, const int *ids, const unsigned char *slots, int numSegs) const {
+		uint64 c0 = walk.counts[0], c1 = walk.counts[1], c2 = walk.counts[2];
+		uint64 overflow = walk.overflow;
+		int state = walk.state;
+		int repeats = walk.repeats;
+		int prev = walk.prev;
+
+		for (int i = 0; i < numSegs; i++) {
+			int id = ids[i];
+			const uint64 *inc = &_countIncrements[id * 3];
+
+			state = step(state, slots[i], id);
+
+			int content = _contentClass[id];
+			repeats |= (content == prev);
+			prev = content;
+
+			// one nibble per phoneme, biased so that going over the limit
+			// sets its top bit; clearing it keeps the adds carry free
+			c0 += inc[0]; c1 += inc[1]; c2 += inc[2];
+			overflow |= (c0 | c1 | c2) & 0x8888888888888888ULL;
+			c0 &= 0x7777777777777777ULL;
+			c1 &= 0x7777777777777777ULL;
+			c2 &= 0x7777777777777777ULL;
+		}
+
+		walk.counts[0] = c0; walk.counts[1] = c1; walk.counts[2] = c2;
+		walk.overflow = overflow;
+		walk.state = state;
+		walk.repeats = repeats;
+		walk.prev = prev;
+	}
+
+	// every failure sticks, so a walk rejected here rejects every word it
+	// starts as well
+	bool accepts(const Walk &walk) const {
+		return walk.state != kDeadState && !(_noRepeat && walk.repeats) && !walk.overflow;
+	}
+
+	// segment ids and slots of a word
+	bool accepts(const int *ids, const unsigned char *slots, int numSegs, int state) const {
+		Walk walk = startWalk(state);
+		extend(walk, ids, slots, numSegs);
+		return accepts(walk);
+	}
+
+	bool accepts(const int *ids, const unsigned char *slots, int numSegs) const {
+		return accepts(ids, slots, numSegs, _startState);
+	}
+
+	bool acceptsSyllable(const Syllable &s) const;
+
+	// evaluates an item of the rule language for every (slot, segment id),
+	// into symbols[slot * numSegments() + id]; false on syntax errors and
+	// variables, which only mean something inside forbid rules
+	bool itemSymbols(const std::string &item, std::vector<char> &symbols) const;
+
+	const Segment &segment(int id) const {
+		return *_segments[id];
+	}
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "positions.h"
+#include "word.h"
+
+// one slot draw of a word: which table, and the ids it may produce
+struct PositionStep {
+	int					position;
+	int					slot;
+	std::vector<int>	ids;		// 0 for the empty onset or coda
+};
+
+// marks the ids that can be part of an accepted DFA walk over steps, false
+// if there is none
+static bool markUsable(const Phonotactics &rules, const std::vector<PositionStep> &steps,
+	std::vector<std::vector<char> > &usable) {
+
+	int numStates = rules.numStates();
+	int numSteps = (int)steps.size();
+
+	// forward[k]: states some prefix reaches before step k
+	std::vector<std::vector<char> > forward(numSteps + 1, std::vector<char>(numStates, 0));
+	forward[0][rules.startState()] = 1;
+	for (int k = 0; k < numSteps; k++) {
+		for (int q = 0; q < numStates; q++) {
+			if (!forward[k][q])
+				continue;
+			for (size_t i = 0; i < steps[k].ids.size(); i++) {
+				int id = steps[k].ids[i];
+				forward[k + 1][id ? rules.step(q, steps[k].slot, id) : q] = 1;
+			}
+		}
+		forward[k + 1][Phonotactics::kDeadState] = 0;
+	}
+
+	// backward[k]: states from which the remaining steps can be accepted
+	std::vector<std::vector<char> > backward(numSteps + 1, std::vector<char>(numStates, 1));
+	backward[numSteps][Phonotactics::kDeadState] = 0;
+	for (int k = numSteps - 1; k >= 0; k--) {
+		for (int q = 0; q < numStates; q++) {
+			bool any = false;
+			for (size_t i = 0; i < steps[k].ids.size() && !any; i++) {
+				int id = steps[k].ids[i];
+				any = backward[k + 1][id ? rules.step(q, steps[k].slot, id) : q] != 0;
+			}
+			backward[k][q] = any;
+		}
+	}
+
+	for (int k = 0; k < numSteps; k++) {
+		std::vector<char> &marks = usable[steps[k].position * kNumSlots + steps[k].slot];
+		for (int q = 0; q < numStates; q++) {
+			if (!forward[k][q])
+				continue;
+			for (size_t i = 0; i < steps[k].ids.size(); i++) {
+				int id = steps[k].ids[i];
+				if (backward[k + 1][id ? rules.step(q, steps[k].slot, id) : q])
+					marks[id] = 1;
+			}
+		}
+	}
+	return backward[0][rules.startState()] != 0;
+}
+
+// counts the position as empty if no syllable of its tables passes the
+// syllable rules, which the generators draw until one does
+void PositionalTables::checkSyllables(const Phonotactics &rules, int position) {
+	const SegmentDistribution &onsets = _tables[position][kSlotOnset].distribution();
+	const SegmentDistribution &nuclei = _tables[position][kSlotNucleus].distribution();
+	const SegmentDistribution &codas = _tables[position][kSlotCoda].distribution();
+	int numCodas = isClosedPosition(position) ? codas.size() : 1;
+
+	Syllable s;
+	for (int o = 0; o < onsets.size(); o++) {
+		s.onset = onsets.item(o);
+		for (int n = 0; n < nuclei.size(); n++) {
+			s.nucleus = nuclei.item(n);
+			for (int c = 0; c < numCodas; c++) {
+				s.coda = isClosedPosition(position) ? codas.item(c) : Segment();
+				if (rules.acceptsSyllable(s))
+					return;
+			}
+		}
+	}
+	_numEmpty++;
+}
+
+PositionalTables::PositionalTables(const Phonotactics &rules, const SegmentDistribution *dists) :
+	_rules(&rules), _numDropped(0), _numEmpty(0), _wordLengths(0) {
+	std::vector<std::vector<char> > usable(kNumPositions * kNumSlots, std::vector<char>(rules.numSegments(), 0));
+
+	std::vector<int> ids[kNumSlots];
+	for (int slot = 0; slot < kNumSlots; slot++)
+		for (int i = 0; i < dists[slot].size(); i++)
+			ids[slot].push_back(dists[slot].item(i)._numItems > 0 ? dists[slot].item(i)._id : 0);
+
+	for (int n = 1; n <= MAX_SYLLABLES; n++) {
+		std::vector<PositionStep> steps;
+		for (int syl = 0; syl < n; syl++) {
+			int position = syllablePosition(syl, n);
+			for (int slot = 0; slot < kNumSlots; slot++) {
+				if (slot == kSlotCoda && !isClosedPosition(position))
+					continue;
+
+				PositionStep step;
+				step.position = position;
+				step.slot = slot;
+				step.ids = ids[slot];
+				steps.push_back(step);
+			}
+		}
+		if (markUsable(rules, steps, usable))
+			_wordLengths |= 1u << n;
+	}
+
+	for (int position = 0; position < kNumPositions; position++) {
+		for (int slot = 0; slot < kNumSlots; slot++) {
+			if (slot == kSlotCoda && !isClosedPosition(position))
+				continue;
+
+			const std::vector<char> &marks = usable[position * kNumSlots + slot];
+			SegmentDistribution kept;
+			for (int i = 0; i < dists[slot].size(); i++) {
+				if (marks[ids[slot][i]])
+					kept.addItem(dists[slot].item(i), dists[slot].frequency(i));
+				else
+					_numDropped++;
+			}
+
+			// a slot nothing can fill leaves the table as it was, so that
+			// its words are still drawn and rejected
+			if (kept.size() == 0)
+				_numEmpty++;
+			_tables[position][slot] = AliasTable<Segment>(kept.size() > 0 ? kept : dists[slot]);
+		}
+		checkSyllables(rules, position);
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef __POSITIONS__
+#define __POSITIONS__
+
+#include "misc.h"
+#include "phonetics.h"
+#include "phonotactics.h"
+
+typedef Distribution<Segment> SegmentDistribution;
+
+// where a syllable sits in its word; a one syllable word is kPositionOnly
+enum SyllablePosition {
+	kPositionInitial,
+	kPositionMedial,
+	kPositionFinal,
+	kPositionOnly,
+	kNumPositions
+};
+
+inline int syllablePosition(int index, int numSyllables) {
+	if (numSyllables == 1)
+		return kPositionOnly;
+	if (index == 0)
+		return kPositionInitial;
+	return index == numSyllables - 1 ? kPositionFinal : kPositionMedial;
+}
+
+// the last syllable is the closed one
+inline bool isClosedPosition(int position) {
+	return position == kPositionFinal || position == kPositionOnly;
+}
+
+// Segment tables per syllable position, without the segments the rules
+// reject there in every word, frozen into alias tables.
+//
+// For every word length the DFA states reachable before each slot and the
+// states from which some completion is accepted are computed; a segment
+// stays in a position if for some length it leads from the one to the
+// other. Dropping a segment only removes words that would all be rejected
+// and the rest keep their relative weights, so the valid words come out
+// with the same distribution, just with fewer rejections on the way.
+class PositionalTables {
+
+	AliasTable<Segment>		_tables[kNumPositions][kNumSlots];
+	const Phonotactics		*_rules;
+	int						_numDropped;
+	int						_numEmpty;
+	uint32					_wordLengths;	// bit n: some word of n syllables passes
+
+	void checkSyllables(const Phonotactics &rules, int position);
+
+public:
+	PositionalTables() : _rules(0), _numDropped(0), _numEmpty(0), _wordLengths(0) {
+	}
+
+	// dists are the onset, nucleus and coda tables; the rules must outlive
+	// the tables
+	PositionalTables(const Phonotactics &rules, const SegmentDistribution *dists);
+
+	// the rules words drawn from the tables are validated with
+	const Phonotactics &rules() const {
+		return *_rules;
+	}
+
+	const AliasTable<Segment> &table(int position, int slot) const {
+		return _tables[position][slot];
+	}
+
+	// (position, slot, segment) entries left out
+	int numDropped() const {
+		return _numDropped;
+	}
+
+	// (position, slot) tables nothing the rules accept can be drawn from,
+	// and positions whose syllables all fail acceptsSyllable(); generators
+	// drawing from such a position never finish
+	int numEmpty() const {
+		return _numEmpty;
+	}
+
+	// some word of that many syllables passes the rules
+	bool hasWords(int numSyllables) const {
+		return numSyllables > 0 && numSyllables < 32 && ((_wordLengths >> numSyllables) & 1) != 0;
+	}
+};
+
+#endif
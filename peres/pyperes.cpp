@@ -0,0 +1,604 @@
+// CPython module "peres" around the generator, for Python 2.6+ and 3.
+//
+// The phonology, rules and spelling tables are built once per process on
+// first use and shared by every Generator. A batch is drawn, validated and
+// rendered with the interpreter lock released; the only Python work left
+// is one string object per name, or none at all with fill(), which writes
+// NUL padded records of NAME_LEN bytes straight into a writable buffer
+// such as a bytearray or a numpy array of dtype 'S64'. A Syllabary holds a
+// compiled tpnames corpus and returns the names names.py would, a Grammar
+// expands templates over word lists like the jlafont scripts.
+//
+//	import peres
+//	gen = peres.Generator(seed=42, syllables={2: 3, 3: 1}, orthography=True)
+//	names = gen.batch(1000)
+//	block = bytearray(1000 * peres.NAME_LEN)
+//	gen.fill(block)
+//	peres.Syllabary('starwars.txt').generate(42)
+
+#include <Python.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include <new>
+#include <vector>
+
+#include "misc.h"
+#include "generator.h"
+#include "batch.h"
+#include "blocklist.h"
+#include "orthography.h"
+#include "entitynames.h"
+#include "syllabary.h"
+#include "grammar.h"
+
+#if PY_MAJOR_VERSION >= 3
+#define PyString_FromStringAndSize	PyUnicode_FromStringAndSize
+#define PyInt_FromLong				PyLong_FromLong
+#define PyInt_AsLong				PyLong_AsLong
+#define PyInt_AsUnsignedLongLongMask	PyLong_AsUnsignedLongLongMask
+#endif
+
+// everything a Generator owns; the word generator keeps references to the
+// seed and the blocklist, so they live side by side
+struct GeneratorState {
+	KeyedSeed				seed;
+	Blocklist				blocklist;
+	EnglishWordGenerator	wordGen;
+	BatchGenerator			batchGen;
+
+	GeneratorState(uint64 key) : seed(key), wordGen(seed, seed), batchGen(wordGen) {
+	}
+
+	// count names into names[i * MAX_NAME_LEN], padded with NULs; blocks are
+	// rendered in place and only the tail goes through a scratch block
+	void generate(char *names, Py_ssize_t count) {
+		char scratch[BATCH_LANES * MAX_NAME_LEN];
+		char *first = names;
+		Py_ssize_t total = count;
+
+		while (count >= BATCH_LANES) {
+			int n = batchGen.generateBlock(names);
+			names += n * MAX_NAME_LEN;
+			count -= n;
+		}
+		while (count > 0) {
+			int n = batchGen.generateBlock(scratch);
+			if (n > count)
+				n = (int)count;
+			memcpy(names, scratch, n * MAX_NAME_LEN);
+			names += n * MAX_NAME_LEN;
+			count -= n;
+		}
+
+		for (Py_ssize_t i = 0; i < total; i++) {
+			char *name = first + i * MAX_NAME_LEN;
+			size_t length = strlen(name);
+			memset(name + length, 0, MAX_NAME_LEN - length);
+		}
+	}
+};
+
+typedef struct {
+	PyObject_HEAD
+	GeneratorState	*state;
+	bool			busy;		// a call is running with the lock released
+} GeneratorObject;
+
+// sizes records for count texts of stride bytes each; false with the Python
+// error set if that does not fit in memory or in a Py_ssize_t
+static bool allocRecords(std::vector<char> &records, Py_ssize_t count, Py_ssize_t stride) {
+	if (count > (PY_SSIZE_T_MAX - 1) / stride) {
+		PyErr_SetString(PyExc_OverflowError, "count too large");
+		return false;
+	}
+	try {
+		records.resize(count * stride + 1);
+	} catch (std::bad_alloc &) {
+		PyErr_NoMemory();
+		return false;
+	}
+	return true;
+}
+
+static PyObject *newNameList(const char *names, Py_ssize_t count, int stride = MAX_NAME_LEN) {
+	PyObject *list = PyList_New(count);
+	if (!list)
+		return 0;
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		const char *name = names + i * stride;
+		PyObject *s = PyString_FromStringAndSize(name, strlen(name));
+		if (!s) {
+			Py_DECREF(list);
+			return 0;
+		}
+		PyList_SET_ITEM(list, i, s);
+	}
+	return list;
+}
+
+// the state is not shared between threads, a second caller is refused
+// instead of waiting on the first
+static bool acquire(GeneratorObject *self) {
+	if (!self->state) {
+		PyErr_SetString(PyExc_RuntimeError, "Generator is not initialized");
+		return false;
+	}
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "Generator is in use by another thread");
+		return false;
+	}
+	self->busy = true;
+	return true;
+}
+
+static int Generator_init(GeneratorObject *self, PyObject *args, PyObject *kwds) {
+	static const char *keywords[] = { "seed", "syllables", "orthography", "blocklist", 0 };
+	unsigned long long seed = 0;
+	PyObject *syllables = 0;
+	PyObject *orthography = 0;
+	const char *blocklist = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|KOOz:Generator", (char **)keywords,
+			&seed, &syllables, &orthography, &blocklist))
+		return -1;
+
+	// the running call holds on to the state it would free
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "Generator is in use by another thread");
+		return -1;
+	}
+
+	// syllables maps a syllable count to its weight
+	CountDistribution counts;
+	if (syllables && syllables != Py_None) {
+		if (!PyDict_Check(syllables)) {
+			PyErr_SetString(PyExc_TypeError, "syllables must be a dict of count: weight");
+			return -1;
+		}
+		Py_ssize_t pos = 0;
+		PyObject *key, *value;
+		while (PyDict_Next(syllables, &pos, &key, &value)) {
+			long n = PyInt_AsLong(key);
+			long weight = PyInt_AsLong(value);
+			if (PyErr_Occurred())
+				return -1;
+			if (n < 1 || n > MAX_SYLLABLES || weight < 0) {
+				PyErr_Format(PyExc_ValueError, "syllable counts must be 1..%d with weights >= 0", MAX_SYLLABLES);
+				return -1;
+			}
+			counts.addItem((unsigned char)n, (int)weight);
+		}
+		if (counts.size() == 0) {
+			PyErr_SetString(PyExc_ValueError, "syllables has no positive weight");
+			return -1;
+		}
+	}
+
+	int spell = orthography ? PyObject_IsTrue(orthography) : 0;
+	if (spell < 0)
+		return -1;
+
+	GeneratorState *state = new GeneratorState(seed);
+	if (blocklist && !state->blocklist.load(blocklist)) {
+		PyErr_SetString(PyExc_IOError, state->blocklist.error().c_str());
+		delete state;
+		return -1;
+	}
+
+	if (counts.size() > 0)
+		state->wordGen.setSyllableCounts(counts);
+	if (blocklist)
+		state->wordGen.setBlocklist(&state->blocklist);
+	if (spell)
+		state->wordGen.setOrthography(&en_orthography());
+
+	delete self->state;
+	self->state = state;
+	self->busy = false;
+	return 0;
+}
+
+static void Generator_dealloc(GeneratorObject *self) {
+	delete self->state;
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Generator_batch(GeneratorObject *self, PyObject *args) {
+	Py_ssize_t count;
+	if (!PyArg_ParseTuple(args, "n:batch", &count))
+		return 0;
+	if (count < 0) {
+		PyErr_SetString(PyExc_ValueError, "count must not be negative");
+		return 0;
+	}
+
+	std::vector<char> names;
+	if (!allocRecords(names, count, MAX_NAME_LEN))
+		return 0;
+	if (!acquire(self))
+		return 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	self->state->generate(&names[0], count);
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	return newNameList(&names[0], count);
+}
+
+static PyObject *Generator_fill(GeneratorObject *self, PyObject *args) {
+	PyObject *target;
+	if (!PyArg_ParseTuple(args, "O:fill", &target))
+		return 0;
+
+	Py_buffer view;
+	if (PyObject_GetBuffer(target, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0)
+		return 0;
+	if (!acquire(self)) {
+		PyBuffer_Release(&view);
+		return 0;
+	}
+
+	Py_ssize_t count = view.len / MAX_NAME_LEN;
+	Py_BEGIN_ALLOW_THREADS
+	self->state->generate((char *)view.buf, count);
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	PyBuffer_Release(&view);
+	return PyInt_FromLong((long)count);
+}
+
+static PyObject *Generator_next(GeneratorObject *self, PyObject *unused) {
+	if (!acquire(self))
+		return 0;
+
+	char buffer[MAX_NAME_LEN];
+	self->state->wordGen.generateValid(buffer);
+	self->busy = false;
+
+	return PyString_FromStringAndSize(buffer, strlen(buffer));
+}
+
+static PyObject *Generator_stats(GeneratorObject *self, PyObject *unused) {
+	if (!self->state) {
+		PyErr_SetString(PyExc_RuntimeError, "Generator is not initialized");
+		return 0;
+	}
+	return Py_BuildValue("(KK)", (unsigned long long)self->state->batchGen.generated(),
+		(unsigned long long)self->state->batchGen.rejected());
+}
+
+static PyMethodDef Generator_methods[] = {
+	{ "batch", (PyCFunction)Generator_batch, METH_VARARGS,
+		"batch(count) -> list of count valid names" },
+	{ "fill", (PyCFunction)Generator_fill, METH_VARARGS,
+		"fill(buffer) -> number of names written as NUL padded records of NAME_LEN bytes" },
+	{ "name", (PyCFunction)Generator_next, METH_NOARGS,
+		"name() -> one valid name, without the batch pipeline" },
+	{ "stats", (PyCFunction)Generator_stats, METH_NOARGS,
+		"stats() -> (candidates drawn, candidates rejected) by batch() and fill()" },
+	{ 0 }
+};
+
+static PyTypeObject GeneratorType = {
+	PyVarObject_HEAD_INIT(0, 0)
+	"peres.Generator",
+	sizeof(GeneratorObject),
+};
+
+// a compiled corpus is never written again, so any number of threads can
+// generate from it at once; nor is it replaced, which would pull it from
+// under them
+typedef struct {
+	PyObject_HEAD
+	Syllabary	*syllabary;
+} SyllabaryObject;
+
+static int Syllabary_init(SyllabaryObject *self, PyObject *args, PyObject *kwds) {
+	static const char *keywords[] = { "path", 0 };
+	const char *path;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s:Syllabary", (char **)keywords, &path))
+		return -1;
+	if (self->syllabary) {
+		PyErr_SetString(PyExc_RuntimeError, "Syllabary is already initialized");
+		return -1;
+	}
+
+	Syllabary *syllabary = new Syllabary();
+	if (!syllabary->load(path)) {
+		PyErr_SetString(PyExc_IOError, syllabary->error().c_str());
+		delete syllabary;
+		return -1;
+	}
+
+	self->syllabary = syllabary;
+	return 0;
+}
+
+static void Syllabary_dealloc(SyllabaryObject *self) {
+	delete self->syllabary;
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Syllabary_generate(SyllabaryObject *self, PyObject *args) {
+	long long seed;
+	Py_ssize_t count = 15;
+	if (!PyArg_ParseTuple(args, "L|n:generate", &seed, &count))
+		return 0;
+	if (!self->syllabary) {
+		PyErr_SetString(PyExc_RuntimeError, "Syllabary is not initialized");
+		return 0;
+	}
+	if (count < 0 || count > INT_MAX) {
+		PyErr_SetString(PyExc_ValueError, "count out of range");
+		return 0;
+	}
+
+	int stride = self->syllabary->maxLength() + 1;
+	std::vector<char> names;
+	if (!allocRecords(names, count, stride))
+		return 0;
+	Py_BEGIN_ALLOW_THREADS
+	self->syllabary->generate(seed, (int)count, &names[0], stride);
+	Py_END_ALLOW_THREADS
+
+	return newNameList(&names[0], count, stride);
+}
+
+static PyMethodDef Syllabary_methods[] = {
+	{ "generate", (PyCFunction)Syllabary_generate, METH_VARARGS,
+		"generate(seed, count=15) -> the names names.py generates for seed, seed + 1, ..." },
+	{ 0 }
+};
+
+static PyTypeObject SyllabaryType = {
+	PyVarObject_HEAD_INIT(0, 0)
+	"peres.Syllabary",
+	sizeof(SyllabaryObject),
+};
+
+// immutable once compiled and never replaced, like the Syllabary
+typedef struct {
+	PyObject_HEAD
+	Grammar		*grammar;
+} GrammarObject;
+
+static int Grammar_init(GrammarObject *self, PyObject *args, PyObject *kwds) {
+	static const char *keywords[] = { "path", 0 };
+	const char *path;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s:Grammar", (char **)keywords, &path))
+		return -1;
+	if (self->grammar) {
+		PyErr_SetString(PyExc_RuntimeError, "Grammar is already initialized");
+		return -1;
+	}
+
+	Grammar *grammar = new Grammar();
+	if (!grammar->load(path)) {
+		PyErr_SetString(PyExc_ValueError, grammar->error().c_str());
+		delete grammar;
+		return -1;
+	}
+
+	self->grammar = grammar;
+	return 0;
+}
+
+static void Grammar_dealloc(GrammarObject *self) {
+	delete self->grammar;
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// the symbol of rule and the strings of the values sequence, which keeps
+// them alive until it is released
+static PyObject *parseExpansion(GrammarObject *self, const char *rule, PyObject *values,
+	int &symbol, std::vector<const char *> &args) {
+
+	if (!self->grammar) {
+		PyErr_SetString(PyExc_RuntimeError, "Grammar is not initialized");
+		return 0;
+	}
+	symbol = self->grammar->symbol(rule);
+	if (symbol < 0) {
+		PyErr_Format(PyExc_KeyError, "no list or rule '%s'", rule);
+		return 0;
+	}
+
+	PyObject *seq = values ? PySequence_Fast(values, "args must be a sequence of strings") : PyTuple_New(0);
+	if (!seq)
+		return 0;
+
+	args.resize(PySequence_Fast_GET_SIZE(seq));
+	for (size_t i = 0; i < args.size(); i++) {
+		if (!PyArg_Parse(PySequence_Fast_GET_ITEM(seq, i), "s", &args[i])) {
+			Py_DECREF(seq);
+			return 0;
+		}
+	}
+	return seq;
+}
+
+static PyObject *Grammar_expand(GrammarObject *self, PyObject *args) {
+	const char *rule;
+	long long seed = 0;
+	PyObject *values = 0;
+	if (!PyArg_ParseTuple(args, "s|LO:expand", &rule, &seed, &values))
+		return 0;
+
+	int symbol;
+	std::vector<const char *> strings;
+	PyObject *seq = parseExpansion(self, rule, values, symbol, strings);
+	if (!seq)
+		return 0;
+
+	char buffer[GRAMMAR_MAX_TEXT];
+	KeyedSeed keyed(seed);
+	int length = self->grammar->expand(symbol, keyed, buffer, sizeof(buffer),
+		strings.empty() ? 0 : &strings[0], (int)strings.size());
+	Py_DECREF(seq);
+
+	return PyString_FromStringAndSize(buffer, length);
+}
+
+static PyObject *Grammar_batch(GrammarObject *self, PyObject *args) {
+	const char *rule;
+	long long seed;
+	Py_ssize_t count;
+	PyObject *values = 0;
+	if (!PyArg_ParseTuple(args, "sLn|O:batch", &rule, &seed, &count, &values))
+		return 0;
+	if (count < 0) {
+		PyErr_SetString(PyExc_ValueError, "count must not be negative");
+		return 0;
+	}
+
+	std::vector<char> texts;
+	if (!allocRecords(texts, count, GRAMMAR_MAX_TEXT))
+		return 0;
+
+	int symbol;
+	std::vector<const char *> strings;
+	PyObject *seq = parseExpansion(self, rule, values, symbol, strings);
+	if (!seq)
+		return 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	for (Py_ssize_t i = 0; i < count; i++) {
+		KeyedSeed keyed((uint64)seed + i);
+		self->grammar->expand(symbol, keyed, &texts[i * GRAMMAR_MAX_TEXT], GRAMMAR_MAX_TEXT,
+			strings.empty() ? 0 : &strings[0], (int)strings.size());
+	}
+	Py_END_ALLOW_THREADS
+	Py_DECREF(seq);
+
+	return newNameList(&texts[0], count, GRAMMAR_MAX_TEXT);
+}
+
+static PyMethodDef Grammar_methods[] = {
+	{ "expand", (PyCFunction)Grammar_expand, METH_VARARGS,
+		"expand(rule, seed=0, args=()) -> the expansion of a list or rule, args filling $1, $2, ..." },
+	{ "batch", (PyCFunction)Grammar_batch, METH_VARARGS,
+		"batch(rule, seed, count, args=()) -> count expansions, the i-th as expand(rule, seed + i, args)" },
+	{ 0 }
+};
+
+static PyTypeObject GrammarType = {
+	PyVarObject_HEAD_INIT(0, 0)
+	"peres.Grammar",
+	sizeof(GrammarObject),
+};
+
+// names_for(galaxy_seed, ids) -> list of the stateless names of the ids
+static PyObject *peres_namesFor(PyObject *module, PyObject *args) {
+	unsigned long long galaxySeed;
+	PyObject *ids;
+	if (!PyArg_ParseTuple(args, "KO:names_for", &galaxySeed, &ids))
+		return 0;
+
+	PyObject *seq = PySequence_Fast(ids, "ids must be a sequence of integers");
+	if (!seq)
+		return 0;
+
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+	std::vector<uint64> entityIds(count + 1);
+	for (Py_ssize_t i = 0; i < count; i++) {
+		entityIds[i] = PyInt_AsUnsignedLongLongMask(PySequence_Fast_GET_ITEM(seq, i));
+		if (PyErr_Occurred()) {
+			Py_DECREF(seq);
+			return 0;
+		}
+	}
+	Py_DECREF(seq);
+
+	std::vector<char> names;
+	if (!allocRecords(names, count, MAX_NAME_LEN))
+		return 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	// namesFor takes an int count
+	for (Py_ssize_t done = 0; done < count; done += 0x10000) {
+		int n = count - done < 0x10000 ? (int)(count - done) : 0x10000;
+		namesFor(galaxySeed, &entityIds[done], n, &names[done * MAX_NAME_LEN]);
+	}
+	Py_END_ALLOW_THREADS
+
+	return newNameList(&names[0], count);
+}
+
+static PyMethodDef peres_methods[] = {
+	{ "names_for", peres_namesFor, METH_VARARGS,
+		"names_for(galaxy_seed, ids) -> list of the names of the entity ids" },
+	{ 0 }
+};
+
+static const char peres_doc[] = "Phonology based name generator.";
+
+static PyObject *initModule() {
+	GeneratorType.tp_flags = Py_TPFLAGS_DEFAULT;
+	GeneratorType.tp_doc = "Generator(seed=0, syllables=None, orthography=False, blocklist=None)";
+	GeneratorType.tp_new = PyType_GenericNew;
+	GeneratorType.tp_init = (initproc)Generator_init;
+	GeneratorType.tp_dealloc = (destructor)Generator_dealloc;
+	GeneratorType.tp_methods = Generator_methods;
+	if (PyType_Ready(&GeneratorType) < 0)
+		return 0;
+
+	SyllabaryType.tp_flags = Py_TPFLAGS_DEFAULT;
+	SyllabaryType.tp_doc = "Syllabary(path), a tpnames corpus compiled for splicing";
+	SyllabaryType.tp_new = PyType_GenericNew;
+	SyllabaryType.tp_init = (initproc)Syllabary_init;
+	SyllabaryType.tp_dealloc = (destructor)Syllabary_dealloc;
+	SyllabaryType.tp_methods = Syllabary_methods;
+	if (PyType_Ready(&SyllabaryType) < 0)
+		return 0;
+
+	GrammarType.tp_flags = Py_TPFLAGS_DEFAULT;
+	GrammarType.tp_doc = "Grammar(path), lists and templates compiled for expansion";
+	GrammarType.tp_new = PyType_GenericNew;
+	GrammarType.tp_init = (initproc)Grammar_init;
+	GrammarType.tp_dealloc = (destructor)Grammar_dealloc;
+	GrammarType.tp_methods = Grammar_methods;
+	if (PyType_Ready(&GrammarType) < 0)
+		return 0;
+
+	// builds the shared tables now rather than in the first request
+	en_phonotactics();
+	en_orthography();
+	en_positionalTables();
+
+#if PY_MAJOR_VERSION >= 3
+	static PyModuleDef moduleDef = { PyModuleDef_HEAD_INIT, "peres", peres_doc, -1, peres_methods };
+	PyObject *module = PyModule_Create(&moduleDef);
+#else
+	PyObject *module = Py_InitModule3("peres", peres_methods, peres_doc);
+#endif
+	if (!module)
+		return 0;
+
+	PyObject *type = (PyObject *)&GeneratorType;
+	Py_INCREF(type);
+	PyModule_AddObject(module, "Generator", type);
+	type = (PyObject *)&SyllabaryType;
+	Py_INCREF(type);
+	PyModule_AddObject(module, "Syllabary", type);
+	type = (PyObject *)&GrammarType;
+	Py_INCREF(type);
+	PyModule_AddObject(module, "Grammar", type);
+	PyModule_AddIntConstant(module, "NAME_LEN", MAX_NAME_LEN);
+	PyModule_AddIntConstant(module, "MAX_SYLLABLES", MAX_SYLLABLES);
+	return module;
+}
+
+#if PY_MAJOR_VERSION >= 3
+PyMODINIT_FUNC PyInit_peres() {
+	return initModule();
+}
+#else
+PyMODINIT_FUNC initperes() {
+	initModule();
+}
+#endif
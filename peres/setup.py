@@ -0,0 +1,35 @@
+# Builds the "peres" Python module:
+#
+#     python setup.py build_ext --inplace
+
+try:
+	from setuptools import setup, Extension
+except ImportError:
+	from distutils.core import setup, Extension
+
+sources = [
+	'pyperes.cpp',
+	'batch.cpp',
+	'blocklist.cpp',
+	'en_phonology.cpp',
+	'entitynames.cpp',
+	'family.cpp',
+	'grammar.cpp',
+	'it_phonology.cpp',
+	'mixture.cpp',
+	'namecode.cpp',
+	'orthography.cpp',
+	'phonotactics.cpp',
+	'positions.cpp',
+	'syllabary.cpp',
+]
+
+setup(
+	name = 'peres',
+	version = '1.0',
+	description = 'Phonology based name generator',
+	ext_modules = [
+		Extension('peres', sources = sources,
+			extra_compile_args = ['-std=c++11', '-O2']),
+	],
+)
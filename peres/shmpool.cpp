@@ -0,0 +1,356 @@
+#include <errno.h>
+#include <string.h>
+
+#include <chrono>
+#include <new>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "shmpool.h"
+#include "entitynames.h"
+#include "namecode.h"
+
+// other processes map the same atomics, which only works without locks
+#if ATOMIC_LLONG_LOCK_FREE != 2 || ATOMIC_INT_LOCK_FREE != 2
+#error "SharedNamePool needs lock free 64 bit atomics"
+#endif
+
+// how long open() waits for a segment being created, in 1 ms steps
+#define SHARED_POOL_OPEN_WAIT	1000
+
+struct SharedNamePool::Header {
+	std::atomic<uint64>		magic;			// stored last by the creator
+	uint64					capacity;
+	uint64					seed;
+	uint64					maxIssued;
+	uint64					issuedSlots;	// of the set after the cells, at least 2 * maxIssued
+	std::atomic<int>		refiller;		// pid, 0 for none
+
+	alignas(64) std::atomic<uint64>	claimPos;
+	alignas(64) std::atomic<uint64>	fillPos;
+	std::atomic<uint64>		drawn;			// codeFor() ids the refillers used
+	std::atomic<uint64>		issued;			// hashes in the set
+	std::atomic<uint64>		duplicates;
+	alignas(64) std::atomic<uint64>	misses;
+};
+
+size_t SharedNamePool::segmentSize(uint64 capacity, uint64 issuedSlots) {
+	return sizeof(Header) + capacity * sizeof(uint64) * (MAX_NAME_LEN / 8) + issuedSlots * sizeof(uint64);
+}
+
+std::atomic<uint64> *SharedNamePool::issuedSet() const {
+	return (std::atomic<uint64> *)(_cells + _header->capacity);
+}
+
+// adds the spelling hash to the issued set, false if it was there; only the
+// refiller touches the set, and never fills it past half
+bool SharedNamePool::issue(uint64 hash) {
+	std::atomic<uint64> *set = issuedSet();
+	uint64 mask = _header->issuedSlots - 1;
+
+	// 0 marks free slots
+	hash = hash ? hash : 1;
+	for (uint64 i = mix64(hash) & mask;; i = (i + 1) & mask) {
+		uint64 slot = set[i].load(std::memory_order_relaxed);
+		if (slot == hash)
+			return false;
+		if (slot == 0) {
+			set[i].store(hash, std::memory_order_relaxed);
+			_header->issued.store(_header->issued.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+}
+
+SharedNamePool::SharedNamePool() : _header(0), _cells(0), _size(0), _refilling(false) {
+}
+
+SharedNamePool::~SharedNamePool() {
+	close();
+}
+
+bool SharedNamePool::fail(const std::string &message) {
+	_error = message;
+	return false;
+}
+
+#ifndef _WIN32
+
+bool SharedNamePool::map(int fd, size_t size) {
+	void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return fail(std::string("cannot map the segment: ") + strerror(errno));
+
+	_header = (Header *)data;
+	_cells = (Cell *)((char *)data + sizeof(Header));
+	_size = size;
+	return true;
+}
+
+bool SharedNamePool::create(const char *name, int capacity, uint64 seed, uint64 maxIssued) {
+	close();
+
+	uint64 size = 2;
+	while (size < (uint64)capacity)
+		size <<= 1;
+	uint64 issuedSlots = 2;
+	while (issuedSlots < 2 * maxIssued)
+		issuedSlots <<= 1;
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+	if (fd < 0 && errno == EEXIST) {
+		if (!open(name))
+			return false;
+		if (_header->capacity != size || _header->seed != seed || _header->maxIssued != maxIssued) {
+			close();
+			return fail(std::string(name) + " exists with another capacity, seed or name limit");
+		}
+		return true;
+	}
+	if (fd < 0)
+		return fail(std::string("cannot create ") + name + ": " + strerror(errno));
+
+	size_t bytes = segmentSize(size, issuedSlots);
+	bool mapped = ftruncate(fd, bytes) == 0 ? map(fd, bytes) : fail(std::string("cannot size ") + name + ": " + strerror(errno));
+	::close(fd);
+	if (!mapped) {
+		shm_unlink(name);
+		return false;
+	}
+
+	// the pages are zero, which is also the empty issued set, and nobody
+	// reads them before the magic is in
+	Header *header = new (_header) Header;
+	header->capacity = size;
+	header->seed = seed;
+	header->maxIssued = maxIssued;
+	header->issuedSlots = issuedSlots;
+	header->refiller.store(0, std::memory_order_relaxed);
+	header->claimPos.store(0, std::memory_order_relaxed);
+	header->fillPos.store(0, std::memory_order_relaxed);
+	header->drawn.store(0, std::memory_order_relaxed);
+	header->issued.store(0, std::memory_order_relaxed);
+	header->duplicates.store(0, std::memory_order_relaxed);
+	header->misses.store(0, std::memory_order_relaxed);
+	header->magic.store(SHARED_POOL_MAGIC, std::memory_order_release);
+	return true;
+}
+
+bool SharedNamePool::open(const char *name) {
+	close();
+
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return fail(std::string("cannot open ") + name + ": " + strerror(errno));
+
+	// the creator may still be sizing and initializing the segment
+	struct stat st;
+	int waited = 0;
+	bool ready = false;
+	for (; waited < SHARED_POOL_OPEN_WAIT; waited++) {
+		if (fstat(fd, &st) != 0)
+			break;
+		if ((size_t)st.st_size >= sizeof(Header)) {
+			if (!map(fd, st.st_size)) {
+				::close(fd);
+				return false;
+			}
+			while (waited < SHARED_POOL_OPEN_WAIT && _header->magic.load(std::memory_order_acquire) == 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				waited++;
+			}
+			ready = _header->magic.load(std::memory_order_acquire) == SHARED_POOL_MAGIC;
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	::close(fd);
+
+	if (!ready) {
+		close();
+		return fail(std::string(name) + " is no name pool");
+	}
+	if (_size != segmentSize(_header->capacity, _header->issuedSlots)) {
+		close();
+		return fail(std::string(name) + " has the wrong size");
+	}
+	return true;
+}
+
+void SharedNamePool::close() {
+	if (!_header)
+		return;
+	stopRefilling();
+	munmap(_header, _size);
+	_header = 0;
+	_cells = 0;
+	_size = 0;
+}
+
+bool SharedNamePool::remove(const char *name) {
+	return shm_unlink(name) == 0;
+}
+
+bool SharedNamePool::startRefilling() {
+	if (_refilling)
+		return true;
+
+	int self = (int)getpid();
+	int pid = _header->refiller.load();
+	for (;;) {
+		// a refiller that died without stopping is taken over
+		if (pid != 0 && pid != self && !(kill(pid, 0) != 0 && errno == ESRCH))
+			return fail("process " + std::to_string(pid) + " is refilling");
+		if (_header->refiller.compare_exchange_weak(pid, self))
+			break;
+	}
+
+	_refilling = true;
+	return true;
+}
+
+void SharedNamePool::stopRefilling() {
+	if (!_refilling)
+		return;
+	int self = (int)getpid();
+	_header->refiller.compare_exchange_strong(self, 0);
+	_refilling = false;
+}
+
+#else
+
+bool SharedNamePool::map(int, size_t) {
+	return fail("shared name pools need POSIX shared memory");
+}
+
+bool SharedNamePool::create(const char *, int, uint64, uint64) {
+	return map(-1, 0);
+}
+
+bool SharedNamePool::open(const char *) {
+	return map(-1, 0);
+}
+
+void SharedNamePool::close() {
+}
+
+bool SharedNamePool::remove(const char *) {
+	return false;
+}
+
+bool SharedNamePool::startRefilling() {
+	return map(-1, 0);
+}
+
+void SharedNamePool::stopRefilling() {
+}
+
+#endif
+
+bool SharedNamePool::claim(char *buffer) {
+	if (!_header)
+		return false;
+
+	uint64 mask = _header->capacity - 1;
+	uint64 pos = _header->claimPos.load(std::memory_order_acquire);
+	uint64 words[MAX_NAME_LEN / 8];
+
+	for (;;) {
+		if (pos >= _header->fillPos.load(std::memory_order_acquire)) {
+			_header->misses.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		// a refiller rewrites the cell only once the cursor is past pos, and
+		// then the CAS fails; the acquire loads order its write after the
+		// claim that moved the cursor
+		const Cell &cell = _cells[pos & mask];
+		for (int i = 0; i < MAX_NAME_LEN / 8; i++)
+			words[i] = cell.words[i].load(std::memory_order_acquire);
+
+		if (_header->claimPos.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+			break;
+	}
+
+	memcpy(buffer, words, MAX_NAME_LEN);
+	buffer[MAX_NAME_LEN - 1] = '\0';
+	return true;
+}
+
+int SharedNamePool::refill(int maxNames) {
+	if (!_refilling)
+		return 0;
+
+	const NameCodec &codec = en_nameCodec();
+	uint64 capacity = _header->capacity;
+	uint64 seed = _header->seed;
+	uint64 fill = _header->fillPos.load(std::memory_order_relaxed);
+	uint64 drawn = _header->drawn.load(std::memory_order_relaxed);
+	uint64 duplicates = 0;
+	uint64 words[MAX_NAME_LEN / 8];
+	int count = 0;
+
+	while (count < maxNames && !exhausted() && fill - _header->claimPos.load(std::memory_order_acquire) < capacity) {
+		// segments spelled alike make equal names of different codes; names
+		// are told apart by FNV-1a, a collision only costs the later one
+		for (;;) {
+			memset(words, 0, sizeof(words));
+			codec.render(codeFor(seed, drawn++), (char *)words);
+			if (issue(fnv1a((const char *)words)))
+				break;
+			duplicates++;
+		}
+
+		// the set and the draw counter go first: a refiller dying in between
+		// loses a name instead of issuing it twice
+		_header->drawn.store(drawn, std::memory_order_relaxed);
+
+		Cell &cell = _cells[fill & (capacity - 1)];
+		for (int i = 0; i < MAX_NAME_LEN / 8; i++)
+			cell.words[i].store(words[i], std::memory_order_release);
+		_header->fillPos.store(++fill, std::memory_order_release);
+		count++;
+	}
+
+	if (duplicates)
+		_header->duplicates.fetch_add(duplicates, std::memory_order_relaxed);
+	return count;
+}
+
+bool SharedNamePool::exhausted() const {
+	return _header && _header->issued.load(std::memory_order_relaxed) >= _header->maxIssued;
+}
+
+uint64 SharedNamePool::capacity() const {
+	return _header ? _header->capacity : 0;
+}
+
+uint64 SharedNamePool::occupancy() const {
+	if (!_header)
+		return 0;
+	uint64 claimed = _header->claimPos.load(std::memory_order_relaxed);
+	uint64 filled = _header->fillPos.load(std::memory_order_relaxed);
+	return filled > claimed ? filled - claimed : 0;
+}
+
+void SharedNamePool::getStats(SharedNamePoolStats &stats) const {
+	memset(&stats, 0, sizeof(stats));
+	if (!_header)
+		return;
+	stats.capacity = _header->capacity;
+	stats.occupancy = occupancy();
+	stats.published = _header->fillPos.load(std::memory_order_relaxed);
+	stats.claimed = _header->claimPos.load(std::memory_order_relaxed);
+	stats.misses = _header->misses.load(std::memory_order_relaxed);
+	stats.duplicates = _header->duplicates.load(std::memory_order_relaxed);
+	stats.issued = _header->issued.load(std::memory_order_relaxed);
+	stats.maxIssued = _header->maxIssued;
+	stats.refiller = _header->refiller.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,120 @@
+#ifndef __SHMPOOL__
+#define __SHMPOOL__
+
+#include <atomic>
+#include <string>
+
+#include "misc.h"
+#include "word.h"
+
+// marks an initialized segment, changes with the layout
+#define SHARED_POOL_MAGIC		0x706e736572657002ULL
+
+// names a segment issues over its life unless create() is given another
+// limit; the issued set takes 16 to 32 bytes a name
+#define SHARED_POOL_MAX_ISSUED	(1 << 22)
+
+struct SharedNamePoolStats {
+	uint64	capacity;
+	uint64	occupancy;		// names ready to be claimed
+	uint64	published;		// names put in by refillers
+	uint64	claimed;		// names handed out
+	uint64	misses;			// claims that found the pool empty
+	uint64	duplicates;		// draws the refiller skipped as already issued
+	uint64	issued;			// distinct names drawn, at most maxIssued
+	uint64	maxIssued;
+	int		refiller;		// pid of the refilling process, 0 for none
+};
+
+// A ring of pre-generated names in a POSIX shared memory segment, taken by
+// any number of processes on the host.
+//
+// Claiming is lock-free and needs no round trip to another process: a
+// claimer reads the name at the claim cursor and then advances the cursor
+// by one CAS, and the name is its own if the CAS succeeds. A refiller only
+// overwrites cells the cursor has passed, so a name read before a
+// successful CAS cannot have changed; a failed one means another process
+// was faster and the read is dropped. A claimer dying at any point leaves
+// nothing half taken.
+//
+// One refilling process at a time, registered by pid, tops the ring up.
+// Pool names are those of codeFor(seed, i) for increasing i, skipping any
+// spelled like one issued before, so no name is handed out twice over the life of
+// the segment, across processes and refiller restarts. The spelling hashes
+// issued so far are an open addressed set in the segment, so a new refiller
+// picks up where the last one stopped without replaying its draws; the set
+// is sized at creation and refilling ends once it holds maxIssued names.
+// The names are spelled and validated once, on the refiller, instead of in
+// every server process as it starts.
+class SharedNamePool {
+
+	struct Header;
+
+	struct Cell {
+		std::atomic<uint64>		words[MAX_NAME_LEN / 8];
+	};
+
+	Header					*_header;
+	Cell					*_cells;
+	size_t					_size;
+	std::string				_error;
+
+	bool					_refilling;
+
+	static size_t segmentSize(uint64 capacity, uint64 issuedSlots);
+
+	std::atomic<uint64> *issuedSet() const;
+	bool issue(uint64 hash);
+
+	bool fail(const std::string &message);
+	bool map(int fd, size_t size);
+
+	SharedNamePool(const SharedNamePool &);
+	SharedNamePool &operator=(const SharedNamePool &);
+
+public:
+	SharedNamePool();
+
+	// unmaps and gives up refilling; the segment stays until remove()
+	~SharedNamePool();
+
+	// creates the segment name, "/peres" or so, with capacity rounded up to
+	// a power of two, or opens it if it exists and was made with the same
+	// capacity, seed and maxIssued; false on errors, see error()
+	bool create(const char *name, int capacity, uint64 seed, uint64 maxIssued = SHARED_POOL_MAX_ISSUED);
+
+	// an existing segment
+	bool open(const char *name);
+
+	void close();
+
+	// deletes the segment; processes having it mapped keep their mapping
+	static bool remove(const char *name);
+
+	// a name into buffer, which must hold MAX_NAME_LEN; false if the pool is
+	// empty, the caller may retry later or draw a name itself
+	bool claim(char *buffer);
+
+	// registers this process as the refiller, false if another one that is
+	// still running is
+	bool startRefilling();
+
+	// publishes new names into the cells the claimers have freed, at most
+	// maxNames, returns the number published; only after startRefilling()
+	int refill(int maxNames);
+
+	// maxIssued names were issued, refill() publishes no more
+	bool exhausted() const;
+
+	void stopRefilling();
+
+	uint64 capacity() const;
+	uint64 occupancy() const;
+	void getStats(SharedNamePoolStats &stats) const;
+
+	const std::string &error() const {
+		return _error;
+	}
+};
+
+#endif
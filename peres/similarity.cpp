@@ -0,0 +1,186 @@
+#include <string.h>
+
+#include <algorithm>
+
+#include "similarity.h"
+
+BitParallelPattern::BitParallelPattern() : _length(0) {
+	memset(_peq, 0, sizeof(_peq));
+}
+
+bool BitParallelPattern::set(const char *text, int length) {
+	if (length > 64)
+		return false;
+
+	for (int i = 0; i < _length; i++)
+		_peq[_text[i]] = 0;
+
+	_length = length;
+	for (int i = 0; i < length; i++) {
+		_text[i] = (unsigned char)text[i];
+		_peq[_text[i]] |= 1ULL << i;
+	}
+
+	return true;
+}
+
+int BitParallelPattern::distance(const char *text, int length, int limit) const {
+	if (_length == 0)
+		return length <= limit ? length : limit + 1;
+
+	int diff = length > _length ? length - _length : _length - length;
+	if (diff > limit)
+		return limit + 1;
+
+	// vertical deltas of the current DP column, +1 in pv and -1 in mv;
+	// score tracks its last cell, the distance of the prefix read so far
+	uint64 pv = (_length == 64) ? ~0ULL : (1ULL << _length) - 1;
+	uint64 mv = 0;
+	uint64 last = 1ULL << (_length - 1);
+	int score = _length;
+
+	for (int j = 0; j < length; j++) {
+		uint64 eq = _peq[(unsigned char)text[j]];
+		uint64 xv = eq | mv;
+		uint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64 ph = mv | ~(xh | pv);
+		uint64 mh = pv & xh;
+
+		score += (int)((ph & last) != 0) - (int)((mh & last) != 0);
+
+		// the top row grows by one per text character
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		// each remaining character lowers the score by at most one
+		if (score - (length - j - 1) > limit)
+			return limit + 1;
+	}
+
+	return score <= limit ? score : limit + 1;
+}
+
+int editDistance(const char *a, const char *b) {
+	BitParallelPattern pattern;
+	int la = (int)strlen(a), lb = (int)strlen(b);
+
+	if (!pattern.set(a, la))
+		return -1;
+	return pattern.distance(b, lb, la > lb ? la : lb);
+}
+
+SimilarityFilter::SimilarityFilter(int maxDistance) : _slotMask(1023), _query(0), _verified(0) {
+	_slotKeys.resize(_slotMask + 1, 0);
+	_slotHeads.resize(_slotMask + 1, 0);
+	_maxDistance = maxDistance < 0 ? 0 : maxDistance;
+	_maxDistance = _maxDistance > MAX_SIMILARITY_DISTANCE ? MAX_SIMILARITY_DISTANCE : _maxDistance;
+}
+
+// FNV-1a over the kept characters; deletion positions only ever increase,
+// so each set of deleted positions is visited once
+void SimilarityFilter::deletions(const char *text, int length, int from, int budget, uint64 hash) const {
+	uint64 h = hash;
+	for (int i = from; i < length; i++) {
+		if (budget > 0)
+			deletions(text, length, i + 1, budget - 1, h);
+		h = (h ^ (unsigned char)text[i]) * 0x100000001b3ULL;
+	}
+	_keys.push_back(mix64(h) | 1);
+}
+
+void SimilarityFilter::neighbourhood(const char *name, int length) const {
+	_keys.clear();
+	deletions(name, length, 0, _maxDistance, 0xcbf29ce484222325ULL);
+}
+
+uint32 SimilarityFilter::head(uint64 key) const {
+	for (uint64 i = (key >> 1) & _slotMask; _slotKeys[i]; i = (i + 1) & _slotMask) {
+		if (_slotKeys[i] == key)
+			return _slotHeads[i];
+	}
+	return 0;
+}
+
+uint32 &SimilarityFilter::insertHead(uint64 key) {
+	// keep the table at most half full
+	if (_postings.size() * 2 >= _slotMask) {
+		std::vector<uint64> keys;
+		std::vector<uint32> heads;
+		keys.swap(_slotKeys);
+		heads.swap(_slotHeads);
+
+		_slotMask = _slotMask * 2 + 1;
+		_slotKeys.resize(_slotMask + 1, 0);
+		_slotHeads.resize(_slotMask + 1, 0);
+
+		for (size_t j = 0; j < keys.size(); j++) {
+			if (keys[j])
+				insertHead(keys[j]) = heads[j];
+		}
+	}
+
+	uint64 i = (key >> 1) & _slotMask;
+	while (_slotKeys[i] && _slotKeys[i] != key)
+		i = (i + 1) & _slotMask;
+	_slotKeys[i] = key;
+	return _slotHeads[i];
+}
+
+bool SimilarityFilter::hasNear(const char *name) const {
+	int length = (int)strlen(name);
+
+	if (!_pattern.set(name, length))
+		return false;
+
+	if (++_query == 0) {
+		std::fill(_seen.begin(), _seen.end(), 0);
+		_query = 1;
+	}
+
+	neighbourhood(name, length);
+
+	for (size_t k = 0; k < _keys.size(); k++) {
+		for (uint32 i = head(_keys[k]); i; i = _postings[i - 1].next) {
+			uint32 id = _postings[i - 1].name;
+			if (_seen[id] == _query)
+				continue;
+			_seen[id] = _query;
+
+			_verified++;
+			const char *candidate = _text.at(_offsets[id]);
+			if (_pattern.distance(candidate, (int)strlen(candidate), _maxDistance) <= _maxDistance)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+bool SimilarityFilter::insert(const char *name) {
+	int length = (int)strlen(name);
+
+	// leaves the neighbourhood of name in _keys
+	if (length >= MAX_NAME_LEN || hasNear(name))
+		return false;
+
+	uint32 id = (uint32)_offsets.size();
+	_offsets.push_back((uint32)_text.offset());
+	_text.add(name, length);
+	_seen.push_back(0);
+
+	for (size_t k = 0; k < _keys.size(); k++) {
+		uint32 &head = insertHead(_keys[k]);
+
+		// repeated letters give the same variant more than once
+		if (head && _postings[head - 1].name == id)
+			continue;
+
+		Posting posting = { id, head };
+		_postings.push_back(posting);
+		head = (uint32)_postings.size();
+	}
+
+	return true;
+}
@@ -0,0 +1,105 @@
+#ifndef __SIMILARITY__
+#define __SIMILARITY__
+
+#include <vector>
+
+#include "arena.h"
+#include "misc.h"
+#include "word.h"
+
+// the neighbourhood of a name grows as length^distance
+#define MAX_SIMILARITY_DISTANCE	3
+
+// Levenshtein distance between a fixed pattern of up to 64 characters and
+// any text, computed a column at a time on bit vectors (Myers / Hyyro).
+// The pattern's match masks are built once, so comparing one name against
+// many candidates costs one pass of a few word operations per character.
+class BitParallelPattern {
+
+	uint64			_peq[256];
+	unsigned char	_text[64];
+	int				_length;
+
+public:
+	BitParallelPattern();
+
+	// false if the text is longer than 64 characters
+	bool set(const char *text, int length);
+
+	int length() const {
+		return _length;
+	}
+
+	// distance to text, or limit + 1 as soon as it is clear it is larger
+	int distance(const char *text, int length, int limit) const;
+};
+
+int editDistance(const char *a, const char *b);
+
+// Rejects names within a given edit distance of any name accepted before.
+//
+// Candidates come from a deletion neighbourhood index: every accepted name
+// is filed under the hashes of all the strings obtained by deleting up to
+// maxDistance of its characters. Two strings within maxDistance edits share
+// at least one such string, so a query looks up its own neighbourhood, a
+// few dozen hashes for names of typical length, independently of the
+// catalog size. Only the candidates found that way are verified with the
+// bit-parallel distance. (A partition index over substrings needs fewer
+// keys, but on short names its segments are two or three letters long and
+// the posting lists grow with the catalog.)
+//
+// Not thread safe; shard by first letter or lock around it.
+class SimilarityFilter {
+
+	struct Posting {
+		uint32	name;
+		uint32	next;
+	};
+
+	int								_maxDistance;
+
+	NameArena						_text;			// all accepted
+	std::vector<uint32>				_offsets;		// [name] logical offset into _text
+
+	// open addressed, variant hash (never 0) -> first posting + 1
+	std::vector<uint64>				_slotKeys;
+	std::vector<uint32>				_slotHeads;
+	uint64							_slotMask;
+	std::vector<Posting>			_postings;
+
+	mutable BitParallelPattern		_pattern;		// the last name queried
+	mutable std::vector<uint64>		_keys;			// neighbourhood of the last name
+	mutable std::vector<uint32>		_seen;			// [name] last query that verified it
+	mutable uint32					_query;
+	mutable uint64					_verified;
+
+	void deletions(const char *text, int length, int from, int budget, uint64 hash) const;
+	void neighbourhood(const char *name, int length) const;
+	uint32 head(uint64 key) const;
+	uint32 &insertHead(uint64 key);
+
+public:
+	// maxDistance is clamped to MAX_SIMILARITY_DISTANCE
+	SimilarityFilter(int maxDistance);
+
+	// true if some accepted name is within maxDistance of name
+	bool hasNear(const char *name) const;
+
+	// adds name unless it is too close to an accepted one
+	bool insert(const char *name);
+
+	int size() const {
+		return (int)_offsets.size();
+	}
+
+	const char *name(int index) const {
+		return _text.at(_offsets[index]);
+	}
+
+	// candidates that needed an edit distance computation
+	uint64 verified() const {
+		return _verified;
+	}
+};
+
+#endif
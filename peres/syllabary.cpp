@@ -0,0 +1,110 @@
+#include <ctype.h>
+#include <stdio.h>
+
+#include <unordered_map>
+
+#include "syllabary.h"
+
+// the line's syllables as names.py's makeSyllabary() splits them: on every
+// single blank, so two blanks in a row give an empty syllable
+static void splitLine(const char *begin, const char *end, std::vector<std::string> &syllables) {
+	syllables.clear();
+	while (begin < end && isspace((unsigned char)*begin))
+		begin++;
+	while (end > begin && isspace((unsigned char)end[-1]))
+		end--;
+	if (begin == end || *begin == '#')
+		return;
+
+	for (;;) {
+		const char *blank = begin;
+		while (blank < end && *blank != ' ')
+			blank++;
+
+		std::string syllable(begin, blank);
+		for (size_t i = 0; i < syllable.size(); i++)
+			if (syllable[i] == '_')
+				syllable[i] = ' ';
+		if (!syllables.empty() && syllable[0] >= 'A' && syllable[0] <= 'Z')
+			syllable.insert(syllable.begin(), ' ');
+		syllables.push_back(syllable);
+
+		if (blank == end)
+			break;
+		begin = blank + 1;
+	}
+}
+
+bool Syllabary::compile(const char *text) {
+	std::vector<std::vector<uint32> > words;
+	std::unordered_map<std::string, uint32> ids;
+	std::vector<std::string> syllables;
+
+	_text.clear();
+	_offsets.assign(1, 0);
+
+	while (*text) {
+		const char *end = strchr(text, '\n');
+		if (!end)
+			end = text + strlen(text);
+
+		splitLine(text, end, syllables);
+		if (syllables.size() >= 2) {
+			words.push_back(std::vector<uint32>());
+			for (size_t i = 0; i < syllables.size(); i++) {
+				std::unordered_map<std::string, uint32>::iterator it = ids.find(syllables[i]);
+				if (it == ids.end()) {
+					it = ids.insert(std::make_pair(syllables[i], (uint32)_offsets.size() - 1)).first;
+					_text += syllables[i];
+					_offsets.push_back((uint32)_text.size());
+				}
+				words.back().push_back(it->second);
+			}
+		}
+
+		text = *end ? end + 1 : end;
+	}
+
+	if (words.empty()) {
+		_error = "no line with two syllables";
+		return false;
+	}
+
+	// at the last position of the longest word every word ends the name
+	_numWords = (int)words.size();
+	_numPositions = 0;
+	for (int w = 0; w < _numWords; w++)
+		if ((int)words[w].size() > _numPositions)
+			_numPositions = (int)words[w].size();
+
+	// position 0 always takes the first syllable and goes on
+	_table.resize((size_t)_numPositions * _numWords);
+	_maxLength = 0;
+	for (int position = 0; position < _numPositions; position++) {
+		uint32 longest = 0;
+		for (int w = 0; w < _numWords; w++) {
+			const std::vector<uint32> &word = words[w];
+			int last = (int)word.size() - 1;
+			uint32 entry = position == 0 ? word[0] : last <= position ? word[last] | SYLLABARY_LAST : word[position];
+
+			uint32 syllable = entry & ~SYLLABARY_LAST;
+			if (_offsets[syllable + 1] - _offsets[syllable] > longest)
+				longest = _offsets[syllable + 1] - _offsets[syllable];
+			_table[(size_t)position * _numWords + w] = entry;
+		}
+		_maxLength += longest;
+	}
+
+	_error.clear();
+	return true;
+}
+
+bool Syllabary::load(const char *path) {
+	std::string text;
+	if (!readFile(path, text)) {
+		_error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	return compile(text.c_str());
+}
@@ -0,0 +1,114 @@
+#ifndef __SYLLABARY__
+#define __SYLLABARY__
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "misc.h"
+
+// the syllable of a table entry ends the name
+#define SYLLABARY_LAST		0x80000000U
+
+// Names spliced from the syllables of a corpus, as tpnames' names.py does.
+//
+// A corpus line is a source word with its syllables separated by blanks;
+// '_' stands for a blank inside a syllable and a capitalized syllable after
+// the first is preceded by one. Lines starting with '#' and words of fewer
+// than two syllables are skipped. A name takes the first syllable of a
+// random word, then for each following position the syllable of another
+// random word at that position, or that word's last syllable if it has no
+// more after it, which ends the name.
+//
+// What a word contributes at a position is fixed, so the corpus compiles
+// into one row per position holding the syllable id of every word with
+// SYLLABARY_LAST set where the name ends; a draw is one table load. Draws
+// come from PythonSeed, so a name is the one names.py generates for the
+// same integer seed.
+class Syllabary {
+
+	std::string				_text;			// all syllables back to back
+	std::vector<uint32>		_offsets;		// [syllable] into _text, one more at the end
+	std::vector<uint32>		_table;			// [position * _numWords + word]
+	int						_numWords;
+	int						_numPositions;
+	int						_maxLength;
+
+	std::string				_error;
+
+public:
+	Syllabary() : _numWords(0), _numPositions(0), _maxLength(0) {
+	}
+
+	// false if no line has two syllables, see error()
+	bool compile(const char *text);
+
+	bool load(const char *path);
+
+	const std::string &error() const {
+		return _error;
+	}
+
+	int numWords() const {
+		return _numWords;
+	}
+
+	// longest name that can come out, without the terminating NUL
+	int maxLength() const {
+		return _maxLength;
+	}
+
+	// renders the name of seed into buffer, which must hold maxLength() + 1
+	// chars; returns its length
+	int generate(long long seed, char *buffer) const {
+		PythonSeed random(seed);
+		return generate(random, buffer);
+	}
+
+	// same for a seed given by sign and magnitude
+	int generate(bool negative, uint64 magnitude, char *buffer) const {
+		PythonSeed random(negative, magnitude);
+		return generate(random, buffer);
+	}
+
+	// moves a sign and magnitude seed on to seed + 1, which unlike long long
+	// arithmetic goes on past 2^63 - 1
+	static void nextSeed(bool &negative, uint64 &magnitude) {
+		if (!negative)
+			magnitude++;
+		else if (--magnitude == 0)
+			negative = false;
+	}
+
+	// continues from a caller owned seed
+	int generate(Seed &seed, char *buffer) const {
+		char *out = buffer;
+		const uint32 *row = &_table[0];
+
+		for (int position = 0; position < _numPositions; position++, row += _numWords) {
+			uint32 entry = row[seed.getBits(_numWords)];
+			uint32 syllable = entry & ~SYLLABARY_LAST;
+			uint32 length = _offsets[syllable + 1] - _offsets[syllable];
+
+			memcpy(out, _text.data() + _offsets[syllable], length);
+			out += length;
+			if (entry & SYLLABARY_LAST)
+				break;
+		}
+
+		*out = '\0';
+		return (int)(out - buffer);
+	}
+
+	// names of seed, seed + 1, ... like names.generate(), the i-th one at
+	// names + i * stride; stride must be at least maxLength() + 1
+	void generate(long long seed, int count, char *names, int stride) const {
+		bool negative = seed < 0;
+		uint64 magnitude = negative ? 0 - (uint64)seed : (uint64)seed;
+		for (int i = 0; i < count; i++, nextSeed(negative, magnitude))
+			generate(negative, magnitude, names + (size_t)i * stride);
+	}
+};
+
+#endif
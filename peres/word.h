@@ -0,0 +1,224 @@
+#ifndef __WORD__
+#define __WORD__
+
+#include <stdio.h>
+#include <string.h>
+
+#include "misc.h"
+#include "phonetics.h"
+#include "phonotactics.h"
+#include "blocklist.h"
+#include "orthography.h"
+#include "en_phonology.h"
+
+enum type {
+	kNone,
+	kVowel,
+	kConsonant
+} ;
+
+inline bool isVowel(char c) {
+	return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+}
+
+inline bool isConsonant(char c) {
+	return !isVowel(c);
+}
+
+inline type getType(char c) {
+	if (c == 0) return kNone;
+	return isVowel(c) ? kVowel : kConsonant;
+}
+
+// longest word the generators build; three segments per syllable at most
+#define MAX_SYLLABLES	5
+#define MAX_SEGS		(3 * MAX_SYLLABLES)
+
+// upper bound for rendered names, separators included
+#define MAX_NAME_LEN	64
+
+class Word {
+	InlineVector<Segment, MAX_SEGS>			segs;
+	InlineVector<unsigned char, MAX_SEGS>	slots;
+	bool overflow;
+
+	void append(const Segment &seg, int slot) {
+		overflow = overflow || !slots.push_back((unsigned char)slot) || !segs.push_back(seg);
+	}
+
+public:
+	Word(const Syllable *syllables, int numSyllables) : overflow(false) {
+		for (int i = 0; i < numSyllables; i++) {
+			if (syllables[i].hasOnset()) {
+				append(syllables[i].onset, kSlotOnset);
+			}
+
+			append(syllables[i].nucleus, kSlotNucleus);
+
+			if (syllables[i].hasCoda()) {
+				append(syllables[i].coda, kSlotCoda);
+			}
+		}
+	}
+
+	int numSegments() const {
+		return segs.size();
+	}
+
+	const Segment &segment(int index) const {
+		return segs[index];
+	}
+
+	int slot(int index) const {
+		return slots[index];
+	}
+
+	// runs the phonotactic rules over the segment ids in one pass; words
+	// that did not fit in MAX_SEGS are always rejected
+	bool validate(const Phonotactics &rules) const {
+		int ids[MAX_SEGS];
+		int numSegs = segs.size();
+
+		for (int i = 0; i < numSegs; i++)
+			ids[i] = segs[i]._id;
+
+		return !overflow && rules.accepts(ids, slots.data(), numSegs);
+	}
+
+	bool validate() const {
+		return validate(en_phonotactics());
+	}
+
+	// continues a walk of the rules over this word's segments, for words
+	// assembled from parts that share a prefix
+	bool validate(const Phonotactics &rules, Phonotactics::Walk &walk) const {
+		int ids[MAX_SEGS];
+		int numSegs = segs.size();
+
+		for (int i = 0; i < numSegs; i++)
+			ids[i] = segs[i]._id;
+
+		rules.extend(walk, ids, slots.data(), numSegs);
+		return !overflow && rules.accepts(walk);
+	}
+
+	void render(char *buffer) const {
+		char *dst = buffer;
+		int numSegs = segs.size();
+
+		*dst = '\0';
+		int i;
+		for (i = 0; i < numSegs; i++) {
+			dst += sprintf(dst, "%s", segs[i]._spelling);
+		}
+	}
+
+	// scans the spellings for blocked substrings as they are appended and
+	// stops at the segment completing one; buffer then holds the name up to
+	// the segment before it
+	bool render(char *buffer, const Blocklist &blocklist) const {
+		uint32 state = blocklist.start();
+		char *dst = buffer;
+		int numSegs = segs.size();
+
+		*dst = '\0';
+		for (int i = 0; i < numSegs; i++) {
+			const char *spelling = segs[i]._spelling;
+			if (!blocklist.feed(state, spelling))
+				return false;
+
+			int len = (int)strlen(spelling);
+			memcpy(dst, spelling, len + 1);
+			dst += len;
+		}
+		return true;
+	}
+
+	// spells every segment by the orthography's rules for its neighbours
+	void render(char *buffer, const Orthography &orthography) const {
+		int ids[MAX_SEGS];
+		int numSegs = segs.size();
+
+		for (int i = 0; i < numSegs; i++)
+			ids[i] = segs[i]._id;
+
+		orthography.render(ids, slots.data(), numSegs, buffer);
+	}
+
+	// bit i is set where a segment other than the first starts at byte i of
+	// the rendered name, which is where renderSegmented() puts its '-'
+	uint64 segmentStarts(const Orthography *orthography) const {
+		uint64 starts = 0;
+		int numSegs = segs.size();
+		int pos = 0;
+
+		for (int i = 0; i < numSegs; i++) {
+			if (i > 0 && pos < 64)
+				starts |= (uint64)1 << pos;
+
+			if (orthography) {
+				int left = i > 0 ? orthography->symbol(slots[i - 1], segs[i - 1]._id) : orthography->boundary();
+				int right = i + 1 < numSegs ? orthography->symbol(slots[i + 1], segs[i + 1]._id) : orthography->boundary();
+				const char *text;
+				pos += orthography->spelling(left, orthography->symbol(slots[i], segs[i]._id), right, text);
+			} else {
+				pos += (int)strlen(segs[i]._spelling);
+			}
+		}
+		return starts;
+	}
+
+	void renderSegmented(char *buffer) const {
+		char *dst = buffer;
+		int numSegs = segs.size();
+
+		*dst = '\0';
+		if (numSegs == 0)
+			return;
+
+		int i;
+		for (i = 0; i < numSegs-1; i++) {
+			dst += sprintf(dst, "%s-", segs[i]._spelling);
+		}
+		sprintf(dst, "%s", segs[i]._spelling);
+	}
+
+
+	void render2(char *buffer) const {
+
+		char temp[100];
+		char *dst = temp;
+		int numSegs = segs.size();
+
+		*dst = '\0';
+		int i;
+		for (i = 0; i < numSegs; i++) {
+			dst += sprintf(dst, "%s", segs[i]._spelling);
+		}
+
+		char temp2[100] = "";
+		type cl, cl2;
+		int j = 0;
+
+		i = 0;
+		cl2 = getType(temp[i]);
+		while (cl2 != kNone) {
+			temp2[j++] = temp[i];
+			i++;
+
+			cl = getType(temp[i]);
+			if (cl == 0) {
+				temp2[j++] = '\0';
+			} else
+			if (cl != cl2) {
+				temp2[j++] = '-';
+			}
+			cl2 = cl;
+		}
+
+		strcpy(buffer, temp2);
+	}
+
+};
+
+#endif